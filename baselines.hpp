@@ -0,0 +1,122 @@
+/**
+ * @brief Enecuum difficulty prediction neural network - Reference controllers
+ *
+ * @file baselines.hpp
+ *
+ * Classic difficulty retargeting algorithms, for comparing the network
+ * controller against. All work on one block series each: they see the
+ * realised block time and return the difficulty for the next block, where
+ * the expected block time is proportional to the difficulty.
+ */
+
+#pragma once
+
+#include "enecuum.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace enecuum {
+    /**
+     * @brief Bitcoin style retarget: fixed difficulty for a window of blocks,
+     * then scaled by how far the window was off target.
+     */
+    class windowed_retarget {
+    private:
+        double difficulty;
+        size_t window;
+        double limit;
+        double elapsed { 0 };
+        size_t blocks { 0 };
+
+    public:
+        /**
+         * @param difficulty    Initial difficulty
+         * @param window        Blocks per retarget (Bitcoin: 2016)
+         * @param limit         Maximum adjustment factor per retarget (Bitcoin: 4)
+         */
+        explicit windowed_retarget(const double difficulty, const size_t window = 2016, const double limit = 4) noexcept :
+            difficulty { difficulty }, window { window }, limit { limit } {}
+
+        double operator()(const double block_time) noexcept {
+            elapsed += block_time;
+            if (++blocks == window) {
+                const auto factor = (target_time * window) / std::max(elapsed, 1e-9);
+                difficulty *= std::clamp(factor, 1 / limit, limit);
+                elapsed = 0;
+                blocks = 0;
+            }
+            return difficulty;
+        }
+    };
+
+    /**
+     * @brief Absolutely scheduled exponential retarget (ASERT, as used by
+     * Bitcoin Cash). The exact form of an exponential moving average over
+     * all block times.
+     *
+     * Difficulty halves or doubles for every `halflife` worth of block
+     * time the chain is behind or ahead of schedule since the anchor block.
+     */
+    class asert_retarget {
+    private:
+        double anchor;
+        double tau;
+        double schedule { 0 }; // Ideal minus realised time since the anchor
+
+    public:
+        /**
+         * @param difficulty    Anchor difficulty
+         * @param halflife      In blocks (Bitcoin Cash: 288, two days)
+         */
+        explicit asert_retarget(const double difficulty, const double halflife = 288) noexcept :
+            anchor { difficulty }, tau { halflife * target_time } {}
+
+        double operator()(const double block_time) noexcept {
+            schedule += target_time - block_time;
+            return anchor * std::exp2(schedule / tau);
+        }
+    };
+
+    /**
+     * @brief Velocity form PID controller. Returns the change in control
+     * output for an error sample.
+     */
+    class pid {
+    private:
+        double kp, ki, kd;
+        double previous { 0 };
+        double previous_delta { 0 };
+
+    public:
+        constexpr pid(const double kp, const double ki, const double kd) noexcept : kp { kp }, ki { ki }, kd { kd } {}
+
+        double operator()(const double error) noexcept {
+            const auto delta = error - previous;
+            const auto out = kp * delta + ki * error + kd * (delta - previous_delta);
+            previous = error;
+            previous_delta = delta;
+            return out;
+        }
+    };
+
+    /**
+     * @brief PID on the relative block time error, applied in log difficulty.
+     */
+    class pid_retarget {
+    private:
+        double log_difficulty;
+        pid control;
+
+    public:
+        explicit pid_retarget(const double difficulty, const double kp = 0.01, const double ki = 0.003, const double kd = 0) noexcept :
+            log_difficulty { std::log(difficulty) }, control { kp, ki, kd } {}
+
+        double operator()(const double block_time) noexcept {
+            // 1 - t/T has mean 0 on target for exponentially distributed block
+            // times, unlike log(T/t)
+            log_difficulty += control(1 - block_time / target_time);
+            return std::exp(log_difficulty);
+        }
+    };
+}
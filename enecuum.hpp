@@ -0,0 +1,58 @@
+/**
+ * @brief Enecuum difficulty prediction neural network - Shared definitions
+ * 
+ * @file enecuum.hpp
+ * 
+ * The network topology and the algorithm 1.0 targets, shared by the
+ * simulation, the benchmarks and the prediction daemon.
+ */
+
+#pragma once
+
+#include "neural_network_tools/all.hpp"
+
+namespace enecuum {
+    using namespace neural_network_tools;
+
+    static constexpr const state_t target_time { 2.5 * 60 }; // 2.5 minutes in s target time
+    static constexpr const state_t target_pow_share { 0.2 }; // 20% of marks to PoW
+    static constexpr const state_t target_poa_share { 0.8 }; // 80% of marks to PoA
+
+    /**
+     * @brief The controller network.
+     * 
+     * @tparam CFG  Network configuration
+     * @tparam R    Recurrent cluster of the hidden layer, eg `gru` or `mgu`
+     */
+    template <typename CFG = config<SUM_OF_SQUARE>, template <size_t, activation_e> typename R = gru>
+    using network_t = network<CFG,
+                              steer_to_ideal<composite<input<2>, // Target PoW and PoA time
+                                                       ratio<input<2>>>, // Target PoW and PoA ratio
+                                             composite<input<2>, // Realised PoW and PoA time
+                                                       ratio<input<2>>>>, // Realised PoW and PoA ratio
+                              R<(2+2+2+2)*(2+2)*5, TANH>, // 5 times inputs * outputs. General rule of thumb is 2-8 times i*o.
+                              composite<output<2>, // PoW and PoA difficulty
+                                        ratio<output<2>>> // PoW and PoA reward %
+                              >;
+
+    /**
+     * @brief Compile time limits on one controller decision: flops,
+     * transcendental calls, working set bytes and estimated ns, see
+     * cost_model.hpp. The working set has to stay in L2 to serve requests
+     * from the prediction daemon at a steady latency.
+     */
+    static constexpr const cost_budget decision_budget { 20'000, 1'000, 64 * 1024, 10'000 };
+
+    static_assert(cost_model<network_t<>>::fits(decision_budget), "The controller network exceeds the per decision budget");
+
+    /**
+     * @brief Pre-program the targets for algorithm 1.0
+     */
+    template <typename T>
+    constexpr void set_targets(T *const inputs) noexcept {
+        inputs[0] = target_time;
+        inputs[1] = target_time;
+        inputs[2] = target_pow_share;
+        inputs[3] = target_poa_share;
+    }
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace extra_math {
+    /**
+     * Philox4x32-10 counter based random number generator (Salmon et al,
+     * "Parallel random numbers: as easy as 1, 2, 3", SC11).
+     *
+     * Every output is a pure function of (seed, instance, position): the key
+     * is the seed, the counter holds the block number and the instance. So
+     * any slice of any stream can be computed on its own, in any order and on
+     * any thread, and gives the same numbers however the work is split.
+     *
+     * Positions count values: uniform value `v` of type `T` is built from
+     * stream words `[v * W, (v + 1) * W)`, with `W` 1 for `float` and 2 for
+     * `double`. Normal values `2j` and `2j + 1` are a Box-Muller pair made
+     * from uniform values `2j` and `2j + 1`.
+     *
+     * Also a UniformRandomBitGenerator, so it drops into `<random>`
+     * distributions.
+     */
+    class philox4x32 {
+    public:
+        using result_type = uint32_t;
+        using block_t = std::array<uint32_t, 4>;
+
+        static constexpr size_t rounds { 10 };
+
+    private:
+        static constexpr uint32_t multiplier_0 { 0xD2511F53 };
+        static constexpr uint32_t multiplier_1 { 0xCD9E8D57 };
+        static constexpr uint32_t weyl_0 { 0x9E3779B9 };
+        static constexpr uint32_t weyl_1 { 0xBB67AE85 };
+
+        /// Blocks generated together by the bulk fills, as structure of arrays so the rounds vectorise.
+        static constexpr size_t lanes { 16 };
+
+        uint64_t seed_ { 0 };
+        uint64_t instance_ { 0 };
+        uint64_t position_ { 0 };   // Next word for `operator()`
+        block_t buffer_ {};
+
+        template <typename T>
+        static constexpr size_t words_per_value() noexcept {
+            static_assert(std::is_same_v<T, float> || std::is_same_v<T, double>, "Uniform and normal fills produce float or double");
+            return sizeof(T) / sizeof(uint32_t);
+        }
+
+        /// The rounds over `lanes` blocks side by side, one vector lane per block.
+        static void rounds_lanes(uint32_t *__restrict x0, uint32_t *__restrict x1, uint32_t *__restrict x2, uint32_t *__restrict x3,
+                                 uint32_t k0, uint32_t k1) noexcept {
+            for (size_t r = 0; r < rounds; ++r) {
+                for (size_t l = 0; l < lanes; ++l) {
+                    const uint64_t p0 = static_cast<uint64_t>(multiplier_0) * x0[l];
+                    const uint64_t p1 = static_cast<uint64_t>(multiplier_1) * x2[l];
+                    const uint32_t y0 = static_cast<uint32_t>(p1 >> 32) ^ x1[l] ^ k0;
+                    const uint32_t y2 = static_cast<uint32_t>(p0 >> 32) ^ x3[l] ^ k1;
+                    x1[l] = static_cast<uint32_t>(p1);
+                    x3[l] = static_cast<uint32_t>(p0);
+                    x0[l] = y0;
+                    x2[l] = y2;
+                }
+                k0 += weyl_0;
+                k1 += weyl_1;
+            }
+        }
+
+        /// Words `[first, first + n)` of the stream.
+        void words(uint32_t *const out, const uint64_t first, const size_t n) const noexcept {
+            uint64_t block = first / 4;
+            size_t i = 0;
+
+            // Leading partial block
+            if (first % 4) {
+                const auto b = generate(block++);
+                for (size_t w = first % 4; w < 4 && i < n; ++w) out[i++] = b[w];
+            }
+
+            const uint32_t k0 = static_cast<uint32_t>(seed_);
+            const uint32_t k1 = static_cast<uint32_t>(seed_ >> 32);
+            const uint32_t c2 = static_cast<uint32_t>(instance_);
+            const uint32_t c3 = static_cast<uint32_t>(instance_ >> 32);
+            for (; n - i >= 4 * lanes; i += 4 * lanes, block += lanes) {
+                uint32_t x0[lanes], x1[lanes], x2[lanes], x3[lanes];
+                for (size_t l = 0; l < lanes; ++l) {
+                    x0[l] = static_cast<uint32_t>(block + l);
+                    x1[l] = static_cast<uint32_t>((block + l) >> 32);
+                    x2[l] = c2;
+                    x3[l] = c3;
+                }
+                rounds_lanes(x0, x1, x2, x3, k0, k1);
+                for (size_t l = 0; l < lanes; ++l) {
+                    out[i + 4 * l] = x0[l];
+                    out[i + 4 * l + 1] = x1[l];
+                    out[i + 4 * l + 2] = x2[l];
+                    out[i + 4 * l + 3] = x3[l];
+                }
+            }
+
+            // Trailing blocks
+            while (i < n) {
+                const auto b = generate(block++);
+                for (size_t w = 0; w < 4 && i < n; ++w) out[i++] = b[w];
+            }
+        }
+
+        static constexpr float to_unit(const uint32_t a) noexcept {
+            return static_cast<float>(a >> 8) * (1.0f / (1u << 24));
+        }
+
+        static constexpr double to_unit(const uint32_t a, const uint32_t b) noexcept {
+            return static_cast<double>(((static_cast<uint64_t>(a) << 32) | b) >> 11) * (1.0 / (1ull << 53));
+        }
+
+    public:
+        /**
+         * @param seed      Key, selects the family of streams
+         * @param instance  Stream within the family, eg a network or thread index
+         */
+        constexpr explicit philox4x32(const uint64_t seed = 0, const uint64_t instance = 0) noexcept
+            : seed_ { seed }, instance_ { instance } {}
+
+        /// Independent stream `instance` of the same seed.
+        constexpr philox4x32 split(const uint64_t instance) const noexcept {
+            return philox4x32 { seed_, instance };
+        }
+
+        constexpr uint64_t seed() const noexcept { return seed_; }
+        constexpr uint64_t instance() const noexcept { return instance_; }
+
+        /// Block `block` of this stream: 10 rounds over counter (block, instance) with key `seed`.
+        constexpr block_t generate(const uint64_t block) const noexcept {
+            block_t x { static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32),
+                        static_cast<uint32_t>(instance_), static_cast<uint32_t>(instance_ >> 32) };
+            uint32_t k0 = static_cast<uint32_t>(seed_);
+            uint32_t k1 = static_cast<uint32_t>(seed_ >> 32);
+            for (size_t r = 0; r < rounds; ++r) {
+                const uint64_t p0 = static_cast<uint64_t>(multiplier_0) * x[0];
+                const uint64_t p1 = static_cast<uint64_t>(multiplier_1) * x[2];
+                x = { static_cast<uint32_t>(p1 >> 32) ^ x[1] ^ k0, static_cast<uint32_t>(p1),
+                      static_cast<uint32_t>(p0 >> 32) ^ x[3] ^ k1, static_cast<uint32_t>(p0) };
+                k0 += weyl_0;
+                k1 += weyl_1;
+            }
+            return x;
+        }
+
+        /// Uniform `float`s in [-1, 1) from block `block`, the four values of one step.
+        constexpr std::array<float, 4> uniform_block(const uint64_t block) const noexcept {
+            const auto b = generate(block);
+            return { 2 * to_unit(b[0]) - 1, 2 * to_unit(b[1]) - 1, 2 * to_unit(b[2]) - 1, 2 * to_unit(b[3]) - 1 };
+        }
+
+        /**
+         * Fill `out` with uniform values in [lo, hi), values `[first, first + n)` of the stream.
+         */
+        template <typename T>
+        void fill_uniform(T *const out, const size_t n, const uint64_t first = 0, const T lo = 0, const T hi = 1) const noexcept {
+            constexpr size_t W = words_per_value<T>();
+            constexpr size_t chunk { 4 * lanes * 4 };
+            uint32_t w[chunk];
+            const T scale = hi - lo;
+            for (size_t i = 0; i < n; i += chunk / W) {
+                const size_t m = n - i < chunk / W ? n - i : chunk / W;
+                words(w, (first + i) * W, m * W);
+                for (size_t j = 0; j < m; ++j) {
+                    if constexpr (W == 1) {
+                        out[i + j] = lo + scale * to_unit(w[j]);
+                    } else {
+                        out[i + j] = lo + scale * to_unit(w[2 * j], w[2 * j + 1]);
+                    }
+                }
+            }
+        }
+
+        /**
+         * Fill `out` with normal values, values `[first, first + n)` of the stream.
+         */
+        template <typename T>
+        void fill_normal(T *const out, const size_t n, const uint64_t first = 0, const T mean = 0, const T sd = 1) const noexcept {
+            constexpr T two_pi = static_cast<T>(6.283185307179586476925286766559);
+            constexpr size_t chunk { 128 };
+            T u[chunk];
+            const uint64_t pair0 = first / 2;
+            const uint64_t end = first + n;
+            size_t i = 0;
+            for (uint64_t p = pair0; 2 * p < end; p += chunk / 2) {
+                const size_t pairs = (end - 2 * p + 1) / 2 < chunk / 2 ? (end - 2 * p + 1) / 2 : chunk / 2;
+                fill_uniform(u, 2 * pairs, 2 * p);
+                for (size_t j = 0; j < pairs; ++j) {
+                    // 1 - u keeps the log argument in (0, 1]
+                    const T r = sd * std::sqrt(-2 * std::log(1 - u[2 * j]));
+                    const T a = two_pi * u[2 * j + 1];
+                    const uint64_t v = 2 * (p + j);
+                    if (v >= first) out[i++] = mean + r * std::cos(a);
+                    if (v + 1 < end) out[i++] = mean + r * std::sin(a);
+                }
+            }
+        }
+
+        // UniformRandomBitGenerator, consumes the stream word by word from position 0
+
+        static constexpr result_type min() noexcept { return 0; }
+        static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+
+        result_type operator()() noexcept {
+            if (position_ % 4 == 0) buffer_ = generate(position_ / 4);
+            return buffer_[position_++ % 4];
+        }
+
+        /// Skip `n` words.
+        void discard(const uint64_t n) noexcept {
+            const auto p = position_ + n;
+            position_ = p;
+            if (p % 4) buffer_ = generate(p / 4);
+        }
+    };
+}
@@ -3,4 +3,10 @@
 #include "neuron.hpp" // Layer types
 #include "layer_filter.hpp" // Softmax, etc
 #include "network.hpp"
-#include "error_model.hpp"
\ No newline at end of file
+#include "error_model.hpp"
+#include "ensemble.hpp"
+#include "autotune.hpp"
+#include "cost_model.hpp"
+#include "replay_buffer.hpp"
+#include "schedule.hpp"
+
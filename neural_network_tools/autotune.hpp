@@ -0,0 +1,167 @@
+/**
+ * @brief Per layer kernel selection for a network type
+ *
+ * @file autotune.hpp
+ *
+ * Times every dense connection variant (kernels.hpp) and every cluster
+ * kernel variant on each layer of a scratch network, and records the fastest
+ * in the network type's `plan`. The result depends on the machine, so it is
+ * cached in a small text file keyed by the network type:
+ *
+ *     nnt-kernel-plan 1 <type hash> <layers>
+ *     <dense variant> <cluster variant>      one line per layer
+ *
+ * Typical startup: `autotuner<net_t>::use("net.plan");`
+ */
+
+#pragma once
+
+#include "forward_declarations.hpp"
+#include "kernels.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <typeinfo>
+
+
+namespace neural_network_tools {
+    template <typename N>
+    struct autotuner {
+        using plan_t = kernel_plan<N::layers_size>;
+
+        /**
+         * @brief Identifies the network type and layout a plan was tuned for.
+         */
+        static uint64_t signature() noexcept {
+            uint64_t h = 14695981039346656037ull; // FNV-1a
+            for (const char *c = typeid(N).name(); *c; ++c) {
+                h = (h ^ static_cast<uint8_t>(*c)) * 1099511628211ull;
+            }
+            return h ^ N::weights_size;
+        }
+
+        /**
+         * @brief Time all kernel variants per layer and return the fastest.
+         *
+         * @param reps      Calls per timing sample
+         * @param rounds    Samples per variant, the best one counts
+         */
+        static plan_t tune(const size_t reps = 2000, const size_t rounds = 5) {
+            auto net = std::make_unique<N>(); // Keep large networks off the stack
+            net->set_weights();
+            for (size_t i = 0; i < N::states_size; ++i) {
+                net->states[i] = static_cast<state_t>(0.5);
+            }
+            plan_t plan {};
+            tune_layer<0>(*net, plan, reps, rounds);
+            return plan;
+        }
+
+        static bool save(const plan_t& plan, const std::string& path) {
+            std::ofstream f { path };
+            f << "nnt-kernel-plan 1 " << signature() << ' ' << N::layers_size << '\n';
+            for (size_t i = 0; i < N::layers_size; ++i) {
+                f << unsigned(plan.dense[i]) << ' ' << unsigned(plan.cluster[i]) << '\n';
+            }
+            return static_cast<bool>(f);
+        }
+
+        /**
+         * @brief Read a plan written by `save()`.
+         *
+         * @return false if the file is missing, malformed or was tuned for a
+         * different network type; `plan` is left untouched then.
+         */
+        static bool load(plan_t& plan, const std::string& path) {
+            std::ifstream f { path };
+            std::string magic;
+            unsigned version = 0;
+            uint64_t sig = 0;
+            size_t layers = 0;
+            if (!(f >> magic >> version >> sig >> layers) ||
+                magic != "nnt-kernel-plan" || version != 1 || sig != signature() || layers != N::layers_size) {
+                return false;
+            }
+            plan_t p {};
+            for (size_t i = 0; i < N::layers_size; ++i) {
+                unsigned d = 0, c = 0;
+                if (!(f >> d >> c) || d >= dense_kernel_count || c > std::numeric_limits<uint8_t>::max()) {
+                    return false;
+                }
+                p.dense[i] = static_cast<uint8_t>(d);
+                p.cluster[i] = static_cast<uint8_t>(c); // Unknown variants fall back to the reference kernel
+            }
+            plan = p;
+            return true;
+        }
+
+        /**
+         * @brief Load the cached plan for `N` from `path`, or tune and cache
+         * one if there is none, and make it the plan all `N` networks run.
+         */
+        static const plan_t& use(const std::string& path, const size_t reps = 2000) {
+            plan_t plan {};
+            if (!load(plan, path)) {
+                plan = tune(reps);
+                save(plan, path);
+            }
+            N::plan = plan;
+            return N::plan;
+        }
+
+    private:
+        template <size_t I>
+        static void tune_layer(N& net, plan_t& plan, const size_t reps, const size_t rounds) {
+            using T = std::tuple_element_t<I, typename N::layers_t>;
+            constexpr const auto so = N::layout[I].state_offset;
+            constexpr const auto iwo = N::layout[I].internal_weight_offset;
+
+            // Every rep starts from the same buffers, else recurrent states
+            // drift and accumulators grow over the reps
+            if constexpr (has_kernel_variants<T>::value) {
+                plan.cluster[I] = fastest(T::kernel_count, reps, rounds, [&](const uint8_t k) {
+                    std::fill(&net.accumulators[so], &net.accumulators[so] + N::pad(T::size), static_cast<accumulator_t>(0.5));
+                    std::fill(&net.states[so], &net.states[so] + N::pad(T::size), static_cast<state_t>(0.5));
+                    T::activate_kernel(k, &net.accumulators[so], &net.states[so], &net.weights[iwo]);
+                });
+            }
+            if constexpr (I + 1 < N::layers_size) {
+                constexpr const auto nso = N::layout[I + 1].state_offset;
+                plan.dense[I] = fastest(dense_kernel_count, reps, rounds, [&](const uint8_t k) {
+                    std::fill(&net.accumulators[nso], &net.accumulators[nso] + N::pad(N::layout[I + 1].size), accumulator_t {});
+                    N::template connect<I>(k, net.accumulators.data(), net.states.data(), net.weights.data());
+                });
+                tune_layer<I + 1>(net, plan, reps, rounds);
+            }
+        }
+
+        /// Variant `k` of `f(k)` that ran fastest. Each call is timed whole, resets included.
+        template <typename F>
+        static uint8_t fastest(const size_t count, const size_t reps, const size_t rounds, F&& f) {
+            using clock = std::chrono::steady_clock;
+            std::array<clock::duration, std::numeric_limits<uint8_t>::max() + 1> best;
+            best.fill(clock::duration::max());
+            // Variants take turns within each round so that frequency scaling
+            // and other noise hits them all alike
+            for (size_t r = 0; r < rounds; ++r) {
+                for (size_t k = 0; k < count; ++k) {
+                    const auto start = clock::now();
+                    for (size_t i = 0; i < reps; ++i) {
+                        f(static_cast<uint8_t>(k));
+                        asm volatile("" ::: "memory"); // Keep the calls from being merged
+                    }
+                    best[k] = std::min(best[k], clock::now() - start);
+                }
+            }
+            uint8_t choice = 0;
+            for (size_t k = 1; k < count; ++k) {
+                if (best[k] < best[choice]) choice = static_cast<uint8_t>(k);
+            }
+            return choice;
+        }
+    };
+}
@@ -0,0 +1,215 @@
+/**
+ * @brief Compile time cost of one step of a network type
+ *
+ * @file cost_model.hpp
+ *
+ * Counts per layer the floating point operations, transcendental calls
+ * (exp, tanh), weights and the bytes touched by one `activate()`. Everything
+ * is constexpr, so a topology can be checked against a budget with
+ * `static_assert`:
+ *
+ *     static_assert(cost_model<net_t>::fits({ 20'000, 500 })); // flops, transcendentals
+ *
+ * Clusters from outside this library can be costed by specialising
+ * `cluster_cost`.
+ */
+
+#pragma once
+
+#include "forward_declarations.hpp"
+#include "neuron.hpp"
+#include "layer_filter.hpp"
+#include "error_model.hpp"
+
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <utility>
+
+
+namespace neural_network_tools {
+    struct op_count {
+        size_t flops { 0 };
+        size_t transcendentals { 0 };
+
+        constexpr op_count operator+(const op_count& o) const noexcept { return { flops + o.flops, transcendentals + o.transcendentals }; }
+        constexpr op_count operator*(const size_t n) const noexcept { return { flops * n, transcendentals * n }; }
+    };
+
+    /// Cost of one activation function call, following activation.hpp.
+    template <activation_e A>
+    inline constexpr op_count activation_cost {};
+
+    template <> inline constexpr op_count activation_cost<SIGMOID>       { 3, 1 };
+    template <> inline constexpr op_count activation_cost<FAST_SIGMOID>  { 3, 0 };
+    template <> inline constexpr op_count activation_cost<TANH>          { 0, 1 };
+    template <> inline constexpr op_count activation_cost<RELU>          { 1, 0 };
+
+    /**
+     * @brief Cost of one `activate()` of cluster `T`, in `value`.
+     */
+    template <typename T>
+    struct cluster_cost {
+        static_assert(sizeof(T) == 0, "No cost model for this cluster, specialise cluster_cost");
+    };
+
+    template <size_t S, activation_e TA, bool B, bool C>
+    struct cluster_cost<simple<S, TA, B, C>> {
+        static constexpr const op_count value { activation_cost<TA> * S };
+    };
+
+    template <size_t S, activation_e TA, activation_e TRA, activation_e TUA, bool GB, bool B, bool C>
+    struct cluster_cost<gru<S, TA, TRA, TUA, GB, B, C>> {
+        // Gates 3 each, candidate 4, blend 4, plus a bias add per gate
+        static constexpr const op_count value {
+            (op_count { GB ? 17u : 14u, 0 } + activation_cost<TRA> + activation_cost<TUA> + activation_cost<TA>) * S
+        };
+    };
+
+    template <size_t S, gru_variant_e V, activation_e TA, activation_e TRA, activation_e TUA, bool GB, bool B, bool C>
+    struct cluster_cost<reduced_gru<S, V, TA, TRA, TUA, GB, B, C>> {
+        static constexpr const size_t gate { V == GRU1 ? 2u : V == GRU2 ? 1u : 0u };
+        static constexpr const op_count value {
+            (op_count { 2 * gate + (GB ? 9u : 8u), 0 } + activation_cost<TRA> + activation_cost<TUA> + activation_cost<TA>) * S
+        };
+    };
+
+    template <size_t S, activation_e TA, activation_e TFA, bool GB, bool B, bool C>
+    struct cluster_cost<mgu<S, TA, TFA, GB, B, C>> {
+        static constexpr const op_count value {
+            (op_count { GB ? 13u : 11u, 0 } + activation_cost<TFA> + activation_cost<TA>) * S
+        };
+    };
+
+    template <typename... Ts>
+    struct cluster_cost<composite<Ts...>> {
+        static constexpr const op_count value { (cluster_cost<Ts>::value + ...) };
+    };
+
+    template <typename T, typename U, error_scaling_e ES>
+    struct cluster_cost<steer_to_ideal<T, U, ES>> {
+        static constexpr const op_count value { cluster_cost<T>::value + cluster_cost<U>::value };
+    };
+
+    template <typename T>
+    struct cluster_cost<shift_normalise<T>> {
+        static constexpr const op_count value { cluster_cost<T>::value + op_count { 2 * T::size + 1, 0 } };
+    };
+
+    template <typename T>
+    struct cluster_cost<ratio<T>> {
+        static constexpr const op_count value { cluster_cost<T>::value + op_count { 4 * T::size + 3, 0 } };
+    };
+
+    template <typename T>
+    struct cluster_cost<softmax<T>> {
+        static constexpr const op_count value { cluster_cost<T>::value + op_count { 4 * T::size + 1, T::size } };
+    };
+
+    struct layer_cost {
+        size_t neurons { 0 };
+        size_t weights { 0 };           ///< Internal and outgoing weights, without padding
+        size_t flops { 0 };             ///< Cluster activation plus the connection to the next layer
+        size_t transcendentals { 0 };
+        size_t bytes { 0 };             ///< Weights, states and accumulators touched, with padding
+    };
+
+    /**
+     * @brief Limits for `cost_model::fits()`, unset fields don't limit.
+     */
+    struct cost_budget {
+        size_t flops { std::numeric_limits<size_t>::max() };
+        size_t transcendentals { std::numeric_limits<size_t>::max() };
+        size_t bytes { std::numeric_limits<size_t>::max() };
+        double ns { std::numeric_limits<double>::infinity() };
+    };
+
+    /**
+     * @brief Per layer and total cost of one step of network type `N`.
+     */
+    template <typename N>
+    struct cost_model {
+        using layers_t = typename N::layers_t;
+
+        /// Rough machine model for `estimated_ns()`, scalar code on a current x86 core
+        static constexpr const double flops_per_ns { 2 };
+        static constexpr const double ns_per_transcendental { 10 };
+
+    private:
+        template <size_t I>
+        static constexpr layer_cost layer() noexcept {
+            using T = std::tuple_element_t<I, layers_t>;
+            const op_count c = cluster_cost<T>::value;
+            layer_cost l {
+                T::size,
+                T::weights_size,
+                c.flops,
+                c.transcendentals,
+                N::pad(T::weights_size) * sizeof(weight_t) + N::pad(T::size) * (sizeof(accumulator_t) + sizeof(state_t))
+            };
+            if constexpr (I + 1 < N::layers_size) {
+                using U = std::tuple_element_t<I + 1, layers_t>;
+                constexpr const size_t row { N::pad(U::size) };
+                l.weights += (T::size + T::bias) * U::size;
+                l.flops += 2 * T::size * row + (T::bias ? row : 0);
+                l.bytes += (T::size + T::bias) * row * sizeof(weight_t) + row * sizeof(accumulator_t);
+            }
+            return l;
+        }
+
+        template <size_t... I>
+        static constexpr std::array<layer_cost, N::layers_size> make_layers(std::index_sequence<I...>) noexcept {
+            return { layer<I>()... };
+        }
+
+        static constexpr layer_cost make_total() noexcept {
+            layer_cost t {};
+            for (const auto& l : make_layers(std::make_index_sequence<N::layers_size> {})) {
+                t.neurons += l.neurons;
+                t.weights += l.weights;
+                t.flops += l.flops;
+                t.transcendentals += l.transcendentals;
+            }
+            t.bytes = N::weights_size * sizeof(weight_t) + N::states_size * sizeof(state_t) + N::accumulators_size * sizeof(accumulator_t);
+            return t;
+        }
+
+    public:
+        static constexpr const std::array<layer_cost, N::layers_size> layers { make_layers(std::make_index_sequence<N::layers_size> {}) };
+
+        /// Whole step, `bytes` counts every buffer once
+        static constexpr const layer_cost total { make_total() };
+
+        /**
+         * @brief Rough time per step, from the operation counts alone. Good
+         * for rejecting topologies that are far off, not for fine tuning.
+         */
+        static constexpr double estimated_ns() noexcept {
+            return total.flops / flops_per_ns + total.transcendentals * ns_per_transcendental;
+        }
+
+        static constexpr bool fits(const cost_budget& b) noexcept {
+            return total.flops <= b.flops &&
+                   total.transcendentals <= b.transcendentals &&
+                   total.bytes <= b.bytes &&
+                   estimated_ns() <= b.ns;
+        }
+
+        static void print(std::ostream& os) {
+            const auto line = [&](const auto& label, const layer_cost& l) {
+                os << std::left << std::setw(7) << label << std::right
+                   << std::setw(9) << l.neurons
+                   << std::setw(10) << l.weights
+                   << std::setw(11) << l.flops
+                   << std::setw(9) << l.transcendentals
+                   << std::setw(11) << l.bytes << '\n';
+            };
+            os << "layer   neurons   weights      flops   transc      bytes\n";
+            for (size_t i = 0; i < N::layers_size; ++i) {
+                line(i, layers[i]);
+            }
+            line("total", total);
+            os << "Estimated " << estimated_ns() << " ns per step\n";
+        }
+    };
+}
@@ -0,0 +1,204 @@
+/**
+ * @brief Ensemble of identically shaped networks, evaluated in one pass
+ *
+ * @file ensemble.hpp
+ */
+
+#pragma once
+
+#include "forward_declarations.hpp"
+#include "network.hpp"
+
+#include <algorithm>
+
+
+namespace neural_network_tools {
+    /**
+     * @brief `M` weight sets of one network topology, run as a single network.
+     *
+     * All buffers are interleaved per member: element `i` of member `m` lives
+     * at `i * M + m`. Every kernel thus runs its innermost loop across the
+     * members, which the compiler can vectorise, and the shared inputs and
+     * control flow are handled once for all members.
+     *
+     * @tparam N    Network type of a single member
+     * @tparam M    Member count
+     * @tparam EC   Method to combine the member outputs
+     */
+    template <typename N, size_t M, ensemble_combine_e EC = MEAN>
+    class ensemble {
+    private:
+        using layers_t = typename N::layers_t;
+        static constexpr const size_t layer_count { std::tuple_size_v<layers_t> };
+
+        template <size_t... I>
+        constexpr void activate_layers(std::index_sequence<I...>) noexcept {
+            (activate_step<I>(), ...);
+        }
+
+        template <size_t I>
+        constexpr void activate_step() noexcept {
+            constexpr const auto so = N::layout[I].state_offset;
+            constexpr const auto iwo = N::layout[I].internal_weight_offset;
+            activate_interleaved<M, std::tuple_element_t<I, layers_t>>(&accumulators[so * M],
+                                                                       &states[so * M],
+                                                                       &weights[iwo * M]);
+
+            if constexpr (I < (layer_count - 1)) {
+                constexpr const auto sol = so + std::tuple_element_t<I, layers_t>::size;
+                constexpr const auto ewo = N::layout[I].external_weight_offset;
+                constexpr const auto nso = N::layout[I + 1].state_offset;
+                constexpr const auto nsol = nso + N::pad(std::tuple_element_t<I+1, layers_t>::size);
+
+                size_t k = ewo * M;
+                for (auto i = so; i < sol; ++i) {
+                    for (auto j = nso; j < nsol; ++j) {
+                        for (size_t m = 0; m < M; ++m) {
+                            accumulators[j * M + m] += states[i * M + m] * weights[k++];
+                        }
+                    }
+                }
+                if (std::tuple_element_t<I, layers_t>::bias) {
+                    for (auto j = nso; j < nsol; ++j) {
+                        for (size_t m = 0; m < M; ++m) {
+                            accumulators[j * M + m] += weights[k++];
+                        }
+                    }
+                }
+            }
+        }
+
+        template <typename T, size_t S>
+        using array_t = typename N::template array_t<T, S>;
+
+    public:
+        static_assert(M > 0, "An ensemble needs at least one member");
+
+        static constexpr const size_t members { M };
+        static constexpr const size_t inputs_size { N::inputs_size };
+        static constexpr const size_t outputs_size { N::outputs_size };
+        static constexpr const size_t accumulators_size { N::accumulators_size * M };
+        static constexpr const size_t states_size { N::states_size * M };
+        static constexpr const size_t weights_size { N::weights_size * M };
+
+        /// Bytes of buffer space per ensemble, eg to size a `slab`.
+        static constexpr const size_t storage_bytes {
+            N::storage_t::template footprint<accumulator_t, accumulators_size> +
+            N::storage_t::template footprint<state_t, states_size> +
+            N::storage_t::template footprint<weight_t, weights_size>
+        };
+
+        // Interleaved member buffers, stored like those of `N`
+        array_t<accumulator_t,  accumulators_size>  accumulators {};
+        array_t<state_t,        states_size>        states {};
+        array_t<weight_t,       weights_size>       weights {};
+
+        std::array<accumulator_t,   inputs_size>        inputs {};  ///< Shared by all members
+        std::array<state_t,         outputs_size>       outputs {}; ///< Combined member outputs
+        std::array<state_t,         outputs_size>       spread {};  ///< Standard deviation of the member outputs
+        size_t step { 0 };
+
+        ensemble() = default;
+
+        /**
+         * @brief Construct an ensemble with its buffers taken from a slab, for
+         * networks using `arena_storage`.
+         *
+         * @param s Slab, must outlive the ensemble
+         */
+        explicit ensemble(slab& s) : accumulators { s }, states { s }, weights { s } {}
+
+        /**
+         * @brief Set the weights of one member.
+         *
+         * @param m Member index
+         * @param w Weights in the packed (unpadded) layout, as taken by
+         *          `network::set_weights()`
+         */
+        constexpr void set_weights(const size_t m, const std::array<weight_t, N::packed_weights_size>& w) noexcept {
+            size_t q = 0;
+            N::for_each_weight_run([&](const size_t o, const size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    weights[(o + i) * M + m] = w[q + i];
+                }
+                q += n;
+            });
+        }
+
+        /**
+         * @brief Take over the weights of a trained network as member `m`.
+         */
+        constexpr void set_weights(const size_t m, const N& net) noexcept {
+            for (size_t i = 0; i < N::weights_size; ++i) {
+                weights[i * M + m] = net.weights[i];
+            }
+        }
+
+        /**
+         * @brief Output `o` of member `m` from the last activation.
+         */
+        constexpr state_t member_output(const size_t m, const size_t o) const noexcept {
+            return states[(N::outputs_offset + o) * M + m];
+        }
+
+        /**
+         * @brief Confidence in the combined outputs, 1 for unanimous members,
+         * falling towards 0 as the members disagree.
+         */
+        constexpr state_t confidence() const noexcept {
+            state_t t = 0;
+            for (const auto& d : spread) t += d;
+            return 1 / (1 + t / outputs_size);
+        }
+
+        /**
+         * @brief Predict the next output values of all members and combine them.
+         */
+        constexpr void activate() noexcept {
+            for (size_t i = 0; i < inputs_size; ++i) {
+                for (size_t m = 0; m < M; ++m) {
+                    accumulators[i * M + m] = inputs[i];
+                }
+            }
+            activate_layers(std::make_index_sequence<layer_count> {});
+            combine();
+            ++step;
+        }
+
+        /**
+         * @brief Combine the member outputs into `outputs` and `spread`.
+         *
+         * @param trim  Members to drop at each end for `TRIMMED_MEAN`
+         */
+        constexpr void combine(const size_t trim = M / 4) noexcept {
+            const state_t *const o = &states[N::outputs_offset * M];
+            for (size_t i = 0; i < outputs_size; ++i) {
+                const state_t *const v = o + i * M;
+
+                state_t mean = 0;
+                for (size_t m = 0; m < M; ++m) mean += v[m];
+                mean /= M;
+
+                state_t var = 0;
+                for (size_t m = 0; m < M; ++m) var += (v[m] - mean) * (v[m] - mean);
+                spread[i] = sqrt(var / M);
+
+                if constexpr (EC == MEAN) {
+                    outputs[i] = mean;
+                } else {
+                    std::array<state_t, M> sorted;
+                    std::copy(v, v + M, sorted.begin());
+                    std::sort(sorted.begin(), sorted.end());
+                    if constexpr (EC == MEDIAN) {
+                        outputs[i] = (M % 2) ? sorted[M / 2] : (sorted[M / 2 - 1] + sorted[M / 2]) / 2;
+                    } else {
+                        const size_t t = std::min(trim, (M - 1) / 2);
+                        state_t sum = 0;
+                        for (size_t m = t; m < M - t; ++m) sum += sorted[m];
+                        outputs[i] = sum / (M - t - t);
+                    }
+                }
+            }
+        }
+    };
+}
@@ -80,8 +80,8 @@ namespace neural_network_tools {
 
     template <error_aggregation_e>
     struct error_aggregation {
-        template <size_t N>
-        static constexpr auto run(const std::array<error_t, N>& errors) noexcept {
+        template <typename A>
+        static constexpr auto run(const A& errors) noexcept {
             // return std::reduce(errors.begin(), errors.end());
             return std::accumulate(errors.begin(), errors.end(), 0);
         }
@@ -89,8 +89,8 @@ namespace neural_network_tools {
 
     template <>
     struct error_aggregation<SUM_OF_SQUARE> {
-        template <size_t N>
-        static constexpr auto run(const std::array<error_t, N>& errors) noexcept {
+        template <typename A>
+        static constexpr auto run(const A& errors) noexcept {
             error_t t = 0;
             for (const auto& e : errors) t += e * e;
             return t;
@@ -99,8 +99,8 @@ namespace neural_network_tools {
 
     template <>
     struct error_aggregation<EUCLIDEAN_DISTANCE> {
-        template <size_t N>
-        static constexpr auto run(const std::array<error_t, N>& errors) noexcept {
+        template <typename A>
+        static constexpr auto run(const A& errors) noexcept {
             error_t t = 0;
             for (const auto& e : errors) t += e * e;
             return sqrt(t);
@@ -109,8 +109,8 @@ namespace neural_network_tools {
 
     template <>
     struct error_aggregation<PSEUDO_HUBER> {
-        template <size_t N>
-        static constexpr auto run(const std::array<error_t, N>& errors, const error_t slope = 0.5) noexcept {
+        template <typename A>
+        static constexpr auto run(const A& errors, const error_t slope = 0.5) noexcept {
             error_t t = 1;
             for (const auto& e : errors) {
                 const auto s = e / slope;
@@ -129,16 +129,22 @@ namespace neural_network_tools {
      * @tparam U Realisation inputs
      */
     template <typename T, typename U, error_scaling_e ES = PCT100>
-    struct steer_to_ideal : public base_cluster<T::size + U::size, T::bias || U::bias, T::weights_size + U::weights_size, U::size + T::errors_size + U::errors_size> {
-        using base =               base_cluster<T::size + U::size, T::bias || U::bias, T::weights_size + U::weights_size, U::size + T::errors_size + U::errors_size>;
+    struct steer_to_ideal : public base_cluster<T::size + U::size, T::bias || U::bias, T::weights_size + U::weights_size, U::size + T::errors_size + U::errors_size, T::recurrent || U::recurrent> {
+        using base =               base_cluster<T::size + U::size, T::bias || U::bias, T::weights_size + U::weights_size, U::size + T::errors_size + U::errors_size, T::recurrent || U::recurrent>;
         constexpr operator base&() noexcept { return *static_cast<base *const>(this); }
         constexpr operator const base&() const noexcept { return *static_cast<const base *const>(this); }
 
-        static constexpr void activate(accumulator_t *const a, state_t *const s, weight_t *const w __attribute__((unused))) noexcept {
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w __attribute__((unused))) noexcept {
             T::activate(a, s, w);
             U::activate(a + T::size, s + T::size, w + T::weights_size);
         }
 
+        template <size_t M>
+        static constexpr void activate_lanes(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            activate_interleaved<M, T>(a, s, w);
+            activate_interleaved<M, U>(a + T::size * M, s + T::size * M, w + T::weights_size * M);
+        }
+
         static constexpr void check(state_t *const s, error_t *const e) {
             if constexpr (T::size == 1) {
                 for (size_t i = 0; i < T::size; ++i) {
@@ -0,0 +1,204 @@
+/**
+ * @brief Evolution strategies training
+ *
+ * @file evolution.hpp
+ *
+ * Gradient free: each generation evaluates a population of networks whose
+ * weights are the current ones plus and minus Gaussian noise (antithetic
+ * pairs), and moves the weights along the noise, weighted by the rank of
+ * each member's fitness (Salimans et al, "Evolution strategies as a scalable
+ * alternative to reinforcement learning", 2017). The fitness can be anything
+ * that runs a network, eg a closed loop simulation, clamps and all.
+ *
+ * Noise is never stored. Pair `j` of generation `g` is Philox stream
+ * (seed, g << 32 | j), so the update regenerates it, split over the weight
+ * range across threads. Memory stays one network and one noise buffer per
+ * thread, whatever the population size. Results don't depend on the thread
+ * count.
+ */
+
+#pragma once
+
+#include "forward_declarations.hpp"
+#include "network.hpp"
+#include "../extra_math/philox.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+
+namespace neural_network_tools {
+    struct es_settings {
+        size_t population { 32 };       ///< Members per generation, rounded up to whole antithetic pairs
+        double sigma { 0.02 };          ///< Noise standard deviation
+        double learning_rate { 0.01 };
+        double weight_decay { 0 };      ///< Pulls weights to zero, relative to the learning rate
+        size_t threads { 0 };           ///< 0 uses every core
+        uint64_t seed { 1 };
+    };
+
+    struct es_generation {
+        double mean_fitness;
+        double best_fitness;
+    };
+
+    /**
+     * @brief Trains the weights of one network in place.
+     *
+     * @tparam N    Network type
+     */
+    template <typename N>
+    class es_trainer {
+    private:
+        static constexpr const size_t weights { N::packed_weights_size };
+
+        struct worker {
+            std::unique_ptr<N> net { std::make_unique<N>() };
+            std::vector<weight_t> noise;
+        };
+
+        N& centre;
+        es_settings settings;
+        size_t pairs;
+        size_t threads;
+        uint64_t generation_ { 0 };
+        std::vector<worker> workers;
+        std::vector<double> fitness;    // Plus member of pair j at 2j, minus at 2j + 1
+        std::vector<double> gradient;
+
+        extra_math::philox4x32 stream(const size_t pair) const noexcept {
+            return extra_math::philox4x32 { settings.seed, generation_ << 32 | pair };
+        }
+
+        /// Run `f(t)` for `t` in [0, threads) on the worker threads.
+        template <typename F>
+        void parallel(F&& f) {
+            std::vector<std::thread> pool;
+            for (size_t t = 1; t < threads; ++t) pool.emplace_back([&f, t] { f(t); });
+            f(0);
+            for (auto& p : pool) p.join();
+        }
+
+        /// Load `centre + scale * noise` into the worker network, with a fresh state.
+        void load(worker& w, const weight_t scale) const noexcept {
+            N& net = *w.net;
+            net.restore(typename N::snapshot {});
+            net.error = 0;
+            net.last_checked = net.last_learned = 0;
+            size_t q = 0;
+            N::for_each_weight_run([&](const size_t o, const size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    net.weights[o + i] = centre.weights[o + i] + scale * w.noise[q + i];
+                }
+                q += n;
+            });
+        }
+
+        /// Diverged members rank last, and keep the sort well defined.
+        static double finite_or_worst(const double f) noexcept {
+            return std::isnan(f) ? -std::numeric_limits<double>::infinity() : f;
+        }
+
+        /// Rank of each member mapped to [-0.5, 0.5], robust to the fitness scale.
+        std::vector<double> centred_ranks() const {
+            std::vector<size_t> order(fitness.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](const size_t a, const size_t b) { return fitness[a] < fitness[b]; });
+            std::vector<double> r(fitness.size());
+            const double n = std::max<double>(1, fitness.size() - 1);
+            for (size_t i = 0; i < order.size();) {
+                size_t e = i + 1;
+                while (e < order.size() && fitness[order[e]] == fitness[order[i]]) ++e;
+                for (size_t k = i; k < e; ++k) r[order[k]] = (i + e - 1) / (2 * n) - 0.5; // Ties share their mean rank
+                i = e;
+            }
+            return r;
+        }
+
+    public:
+        es_trainer(N& net, const es_settings& s = {})
+            : centre { net }, settings { s }, pairs { std::max<size_t>(1, (s.population + 1) / 2) },
+              threads { s.threads ? s.threads : std::max(1u, std::thread::hardware_concurrency()) },
+              workers(threads), fitness(2 * pairs), gradient(weights) {
+            for (auto& w : workers) w.noise.resize(weights);
+        }
+
+        uint64_t generation() const noexcept { return generation_; }
+
+        /**
+         * @brief Evaluate one generation and update the weights.
+         *
+         * @param f Fitness, higher is better: `double f(N& net, uint64_t generation)`.
+         *          Called concurrently from several threads, each with its own
+         *          network holding the perturbed weights and a zeroed state.
+         *          Use the generation for the episode seed, so all members
+         *          of a generation face the same episode.
+         */
+        template <typename F>
+        es_generation step(F&& f) {
+            std::atomic<size_t> next { 0 };
+            parallel([&](const size_t t) {
+                auto& w = workers[t];
+                for (size_t j; (j = next.fetch_add(1)) < pairs;) {
+                    stream(j).fill_normal(w.noise.data(), weights);
+                    load(w, static_cast<weight_t>(settings.sigma));
+                    fitness[2 * j] = finite_or_worst(f(*w.net, generation_));
+                    load(w, static_cast<weight_t>(-settings.sigma));
+                    fitness[2 * j + 1] = finite_or_worst(f(*w.net, generation_));
+                }
+            });
+
+            const auto ranks = centred_ranks();
+
+            // Regenerate the noise, each thread sums all pairs over its slice of the weights
+            const size_t slice = (weights + threads - 1) / threads;
+            parallel([&](const size_t t) {
+                const size_t first = std::min(weights, t * slice);
+                const size_t n = std::min(weights, first + slice) - first;
+                if (!n) return;
+                auto& w = workers[t];
+                std::fill(gradient.begin() + first, gradient.begin() + first + n, 0);
+                for (size_t j = 0; j < pairs; ++j) {
+                    const double c = ranks[2 * j] - ranks[2 * j + 1];
+                    if (c == 0) continue;
+                    stream(j).fill_normal(w.noise.data(), n, first);
+                    for (size_t i = 0; i < n; ++i) gradient[first + i] += c * w.noise[i];
+                }
+            });
+
+            const double scale = settings.learning_rate / (2 * pairs * settings.sigma);
+            const double decay = settings.learning_rate * settings.weight_decay;
+            size_t q = 0;
+            N::for_each_weight_run([&](const size_t o, const size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    auto& x = centre.weights[o + i];
+                    x = static_cast<weight_t>(x + scale * gradient[q + i] - decay * x);
+                }
+                q += n;
+            });
+            ++generation_;
+
+            return {
+                std::accumulate(fitness.begin(), fitness.end(), 0.0) / fitness.size(),
+                *std::max_element(fitness.begin(), fitness.end())
+            };
+        }
+
+        /**
+         * @brief Fitness of the current weights, on the episode of the next
+         * generation.
+         */
+        template <typename F>
+        double evaluate(F&& f) {
+            auto& w = workers[0];
+            load(w, 0);
+            return f(*w.net, generation_);
+        }
+    };
+}
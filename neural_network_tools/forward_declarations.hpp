@@ -12,4 +12,10 @@ namespace neural_network_tools {
     template <typename CFG, typename...>
     struct network;
 
+    enum ensemble_combine_e {
+        MEAN,
+        MEDIAN,
+        TRIMMED_MEAN
+    };
+
 }
\ No newline at end of file
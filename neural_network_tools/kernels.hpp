@@ -0,0 +1,138 @@
+/**
+ * @brief Alternative implementations of the dense connection kernel
+ *
+ * @file kernels.hpp
+ *
+ * Which variant is fastest depends on the layer shape and the machine, see
+ * autotune.hpp for picking one per layer. Every variant adds the rows to each
+ * accumulator in source order, like `DENSE_ROWS`, so the plan a machine picks
+ * never changes the results.
+ */
+
+#pragma once
+
+#include "forward_declarations.hpp"
+
+#include <algorithm>
+
+
+namespace neural_network_tools {
+    enum dense_kernel_e : uint8_t {
+        DENSE_ROWS,         ///< One source row at a time, the reference implementation
+        DENSE_ROWS_X4,      ///< Four source rows per pass over the accumulators, added one after the other
+        DENSE_TILED,        ///< Column tiles kept hot over all rows
+        DENSE_VECTOR,       ///< Explicit 8 wide vectors over the columns
+        dense_kernel_count
+    };
+
+    /**
+     * @brief Add the weighted states of one layer to the accumulators of the next.
+     *
+     * `w` is row major: a row of `R` weights per source neuron, followed by a
+     * bias row if `B`. Every row is added over its full length `R`, which may
+     * include layout padding.
+     *
+     * @tparam K    Kernel variant
+     * @tparam S    Source neuron count
+     * @tparam R    Row length (destination neurons, plus any padding)
+     * @tparam B    Bias row present
+     */
+    template <dense_kernel_e K, size_t S, size_t R, bool B>
+    constexpr void dense(accumulator_t *const a, const state_t *const s, const weight_t *const w) noexcept {
+        if constexpr (K == DENSE_ROWS) {
+            size_t k = 0;
+            for (size_t i = 0; i < S; ++i) {
+                for (size_t j = 0; j < R; ++j) {
+                    a[j] += s[i] * w[k++];
+                }
+            }
+        } else if constexpr (K == DENSE_ROWS_X4) {
+            // Fewer accumulator loads and stores, the four rows still add up in order
+            constexpr const size_t tail { S - S % 4 };
+            for (size_t i = 0; i < tail; i += 4) {
+                const auto *const w0 = w + i * R;
+                for (size_t j = 0; j < R; ++j) {
+                    auto sum = a[j];
+                    sum += s[i] * w0[j];
+                    sum += s[i + 1] * w0[R + j];
+                    sum += s[i + 2] * w0[2 * R + j];
+                    sum += s[i + 3] * w0[3 * R + j];
+                    a[j] = sum;
+                }
+            }
+            for (size_t i = tail; i < S; ++i) {
+                const auto *const wr = w + i * R;
+                for (size_t j = 0; j < R; ++j) {
+                    a[j] += s[i] * wr[j];
+                }
+            }
+        } else if constexpr (K == DENSE_TILED) {
+            constexpr const size_t tile { 64 };
+            for (size_t jt = 0; jt < R; jt += tile) {
+                const size_t je = std::min(R, jt + tile);
+                for (size_t i = 0; i < S; ++i) {
+                    for (size_t j = jt; j < je; ++j) {
+                        a[j] += s[i] * w[i * R + j];
+                    }
+                }
+            }
+        } else if constexpr (K == DENSE_VECTOR) {
+            using vec_t = accumulator_t __attribute__((vector_size(8 * sizeof(accumulator_t))));
+            constexpr const size_t lanes { sizeof(vec_t) / sizeof(accumulator_t) };
+            for (size_t i = 0; i < S; ++i) {
+                const auto *const wr = w + i * R;
+                size_t j = 0;
+                for (; j + lanes <= R; j += lanes) {
+                    vec_t va, vw;
+                    std::memcpy(&va, a + j, sizeof(vec_t)); // Unaligned safe loads
+                    std::memcpy(&vw, wr + j, sizeof(vec_t));
+                    va += s[i] * vw;
+                    std::memcpy(a + j, &va, sizeof(vec_t));
+                }
+                for (; j < R; ++j) {
+                    a[j] += s[i] * wr[j];
+                }
+            }
+        }
+
+        if constexpr (B) {
+            const auto *const wb = w + S * R;
+            for (size_t j = 0; j < R; ++j) {
+                a[j] += wb[j];
+            }
+        }
+    }
+
+    /**
+     * @brief Run dense kernel variant `k`, chosen at runtime.
+     */
+    template <size_t S, size_t R, bool B>
+    constexpr void dense(const uint8_t k, accumulator_t *const a, const state_t *const s, const weight_t *const w) noexcept {
+        switch (k) {
+            case DENSE_ROWS_X4: dense<DENSE_ROWS_X4, S, R, B>(a, s, w); break;
+            case DENSE_TILED:   dense<DENSE_TILED,   S, R, B>(a, s, w); break;
+            case DENSE_VECTOR:  dense<DENSE_VECTOR,  S, R, B>(a, s, w); break;
+            default:            dense<DENSE_ROWS,    S, R, B>(a, s, w); break;
+        }
+    }
+
+    template <typename T, typename = int>
+    struct has_kernel_variants : std::false_type { };
+
+    template <typename T>
+    struct has_kernel_variants <T, decltype((void) T::kernel_count, 0)> : std::bool_constant<(T::kernel_count > 1)> { };
+
+    /**
+     * @brief Per layer kernel choice of a network.
+     *
+     * All zeroes selects the reference kernels.
+     */
+    template <size_t L>
+    struct kernel_plan {
+        std::array<uint8_t, L> dense {};    ///< `dense_kernel_e` for the connection to the next layer
+        std::array<uint8_t, L> cluster {};  ///< Cluster kernel variant, for clusters that have them
+
+        constexpr bool operator==(const kernel_plan& o) const noexcept { return dense == o.dense && cluster == o.cluster; }
+        constexpr bool operator!=(const kernel_plan& o) const noexcept { return !(*this == o); }
+    };
+}
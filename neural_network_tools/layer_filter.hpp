@@ -1,108 +1,231 @@
 #pragma once
 
 #include "forward_declarations.hpp"
+#include "neuron.hpp"
+
+#include <algorithm>
+#include <limits>
 
 namespace neural_network_tools {
 
     template <typename... Ts>
-    struct composite : base_cluster<(Ts::size + ...), (Ts::bias || ...), (Ts::weights_size + ...), (Ts::errors_size + ...)> {
-        using base =   base_cluster<(Ts::size + ...), (Ts::bias || ...), (Ts::weights_size + ...), (Ts::errors_size + ...)>;
+    struct composite : base_cluster<(Ts::size + ...), (Ts::bias || ...), (Ts::weights_size + ...), (Ts::errors_size + ...), (Ts::recurrent || ...)> {
+        using base =   base_cluster<(Ts::size + ...), (Ts::bias || ...), (Ts::weights_size + ...), (Ts::errors_size + ...), (Ts::recurrent || ...)>;
         constexpr operator base&() noexcept { return *static_cast<base *const>(this); }
         constexpr operator const base&() const noexcept { return *static_cast<const base *const>(this); }
 
-        static constexpr void activate(accumulator_t *const a, state_t *const s, weight_t *const __attribute__((unused)) w) noexcept {
-            // This accounts for offsetting the weight pointer for each
-            // activation. Should be CT.
-            constexpr size_t ss[] { 0, Ts::size... };
-            size_t ws[] { 0, Ts::weights_size... };
-            for (size_t i = 2; i < (sizeof...(Ts) - 1); ++i) {
-                ws[i] += ws[i-1];
-            }
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const __attribute__((unused)) w) noexcept {
+            // Offsets of each member in the states and weights, CT.
+            constexpr const auto ss = prefix_offsets<Ts::size...>();
+            constexpr const auto ws = prefix_offsets<Ts::weights_size...>();
             size_t i = 0;
             ((Ts::activate(a + ss[i], s + ss[i], w + ws[i]), ++i), ...);
         }
 
+        template <typename F>
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w, F&& visit) noexcept {
+            constexpr const auto ss = prefix_offsets<Ts::size...>();
+            constexpr const auto ws = prefix_offsets<Ts::weights_size...>();
+            size_t i = 0;
+            ((activate_visiting<Ts>(a + ss[i], s + ss[i], w + ws[i], visit), ++i), ...);
+        }
+
+        template <size_t M>
+        static constexpr void activate_lanes(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            constexpr const auto ss = prefix_offsets<Ts::size...>();
+            constexpr const auto ws = prefix_offsets<Ts::weights_size...>();
+            size_t i = 0;
+            ((activate_interleaved<M, Ts>(a + ss[i] * M, s + ss[i] * M, w + ws[i] * M), ++i), ...);
+        }
+
         static constexpr void check(state_t *const s, error_t *const e) {
-            constexpr size_t ss[] { 0, Ts::size... };
-            constexpr size_t es[] { 0, Ts::errors_size... };
+            constexpr const auto ss = prefix_offsets<Ts::size...>();
+            constexpr const auto es = prefix_offsets<Ts::errors_size...>();
             size_t i = 0;
             ((Ts::check(s + ss[i], e + es[i]), ++i), ...);
         }
     };
 
+    /*
+     * The filters below gather their statistics through the wrapped cluster's
+     * state visitor, inside its activation loop, and finish with a single
+     * pass over the states. They take a visitor themselves, so they nest.
+     * Filters always run the reference kernel of the cluster they wrap.
+     */
+
+    /**
+     * @brief Subtract the mean of the cluster's states from each state.
+     */
     template <typename T>
     struct shift_normalise : public T {
         constexpr operator T&() noexcept { return *static_cast<T *const>(this); }
         constexpr operator const T&() const noexcept { return *static_cast<const T *const>(this); }
 
-        constexpr void forward() noexcept {
-            T& base = *static_cast<T *const>(this);
+        static constexpr const size_t kernel_count { 1 };
 
-            base.forward();
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            activate(a, s, w, ignore_state {});
+        }
 
-            state_t avg = 0;
+        template <typename F>
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w, F&& visit) noexcept {
+            state_t sum = 0;
+            activate_visiting<T>(a, s, w, [&](const state_t x) { sum += x; });
 
+            const state_t avg = sum * (static_cast<state_t>(1) / T::size);
             for (size_t i = 0; i < T::size; ++i) {
-                avg += base[i] / T::size;
+                s[i] -= avg;
+                visit(s[i]);
             }
+        }
+
+        template <size_t M>
+        static constexpr void activate_lanes(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            activate_interleaved<M, T>(a, s, w);
 
+            std::array<state_t, M> avg {};
             for (size_t i = 0; i < T::size; ++i) {
-                base[i] -= avg;
+                for (size_t m = 0; m < M; ++m) {
+                    avg[m] += s[i * M + m];
+                }
+            }
+            for (size_t m = 0; m < M; ++m) {
+                avg[m] *= static_cast<state_t>(1) / T::size;
+            }
+            for (size_t i = 0; i < T::size; ++i) {
+                for (size_t m = 0; m < M; ++m) {
+                    s[i * M + m] -= avg[m];
+                }
             }
         }
     };
 
+    /**
+     * @brief Shift the cluster's states to a minimum of 0 and scale them to
+     * add up to 1.
+     */
     template <typename T>
     struct ratio : public T {
         constexpr operator T&() noexcept { return *static_cast<T *const>(this); }
         constexpr operator const T&() const noexcept { return *static_cast<const T *const>(this); }
-        
-        static constexpr void activate(accumulator_t *const a, state_t *const s, weight_t *const w) noexcept {
-            T::activate(a, s, w);
 
+        static constexpr const size_t kernel_count { 1 };
+
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            activate(a, s, w, ignore_state {});
+        }
+
+        template <typename F>
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w, F&& visit) noexcept {
             state_t _min = std::numeric_limits<state_t>::max();
             state_t _sum = 0;
+            activate_visiting<T>(a, s, w, [&](const state_t x) {
+                _min = std::min(_min, x);
+                _sum += x;
+            });
+
+            const state_t scale = 1 / (_sum - (T::size * _min));
+            for (size_t i = 0; i < T::size; ++i) {
+                s[i] = (s[i] - _min) * scale;
+                visit(s[i]);
+            }
+        }
+
+        template <size_t M>
+        static constexpr void activate_lanes(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            activate_interleaved<M, T>(a, s, w);
+
+            std::array<state_t, M> _min;
+            std::array<state_t, M> _sum {};
+            _min.fill(std::numeric_limits<state_t>::max());
 
             for (size_t i = 0; i < T::size; ++i) {
-                if (unlikely(s[i] < _min)) {
-                    _min = s[i];
+                for (size_t m = 0; m < M; ++m) {
+                    _min[m] = std::min(_min[m], s[i * M + m]);
+                    _sum[m] += s[i * M + m];
                 }
-                _sum += s[i];
             }
 
+            std::array<state_t, M> scale;
+            for (size_t m = 0; m < M; ++m) {
+                scale[m] = 1 / (_sum[m] - (T::size * _min[m]));
+            }
 
             for (size_t i = 0; i < T::size; ++i) {
-                s[i] = (s[i] - _min) / (_sum - (T::size * _min));
+                for (size_t m = 0; m < M; ++m) {
+                    s[i * M + m] = (s[i * M + m] - _min[m]) * scale[m];
+                }
             }
         }
     };
 
-    // TODO: Verify this implementation
+    /**
+     * @brief Softmax over the cluster's states.
+     * 
+     * The maximum is taken while the wrapped cluster activates, exponent and
+     * sum in one pass after. A fully online normaliser (rescaling the sum
+     * whenever the maximum grows) would save that pass, but costs a second
+     * `exp()` per state, which is dearer than a pass over a cluster that is
+     * in cache anyway.
+     */
     template <typename T>
     struct softmax : public T {
         constexpr operator T&() noexcept { return *static_cast<T *const>(this); }
         constexpr operator const T&() const noexcept { return *static_cast<const T *const>(this); }
-        
-        static constexpr void activate(accumulator_t *const a, state_t *const s, weight_t *const w) noexcept {
-            T::activate(a, s, w);
 
+        static constexpr const size_t kernel_count { 1 };
+
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            activate(a, s, w, ignore_state {});
+        }
+
+        template <typename F>
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w, F&& visit) noexcept {
             state_t max = std::numeric_limits<state_t>::lowest();
+            activate_visiting<T>(a, s, w, [&](const state_t x) { max = std::max(max, x); });
 
+            state_t sum = 0;
             for (size_t i = 0; i < T::size; ++i) {
-                if (unlikely(s[i] > max)) {
-                    max = s[i];
-                }
+                s[i] = exp(s[i] - max);
+                sum += s[i];
             }
 
-            state_t sum = 0;
+            const state_t scale = 1 / sum;
+            for (size_t i = 0; i < T::size; ++i) {
+                s[i] *= scale;
+                visit(s[i]);
+            }
+        }
+
+        template <size_t M>
+        static constexpr void activate_lanes(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            activate_interleaved<M, T>(a, s, w);
+
+            std::array<state_t, M> max;
+            std::array<state_t, M> sum {};
+            max.fill(std::numeric_limits<state_t>::lowest());
 
             for (size_t i = 0; i < T::size; ++i) {
-                s[i] = exp(s[i] - max);
-                sum += s[i];
+                for (size_t m = 0; m < M; ++m) {
+                    max[m] = std::max(max[m], s[i * M + m]);
+                }
             }
 
             for (size_t i = 0; i < T::size; ++i) {
-                s[i] = s[i] / sum;
+                for (size_t m = 0; m < M; ++m) {
+                    s[i * M + m] = exp(s[i * M + m] - max[m]);
+                    sum[m] += s[i * M + m];
+                }
+            }
+
+            for (size_t m = 0; m < M; ++m) {
+                sum[m] = 1 / sum[m];
+            }
+
+            for (size_t i = 0; i < T::size; ++i) {
+                for (size_t m = 0; m < M; ++m) {
+                    s[i * M + m] *= sum[m];
+                }
             }
         }
     };
@@ -13,8 +13,14 @@
 
 #include "forward_declarations.hpp"
 #include "error_model.hpp"
+#include "storage.hpp"
+#include "kernels.hpp"
+#include "../extra_math/philox.hpp"
 
+#include <algorithm>
+#include <array>
 #include <random>
+#include <utility>
 
 
 namespace neural_network_tools {
@@ -22,10 +28,15 @@ namespace neural_network_tools {
      * @brief Aggregation of configuration parameters
      * 
      * @tparam EA Error aggregation method 
+     * @tparam S  Storage policy for the network buffers, see storage.hpp
+     * @tparam LA Layout alignment in bytes: start every layer, weight block
+     *            and weight row on this boundary. 0 packs them back to back.
      */
-    template <error_aggregation_e EA = SUM_OF_SQUARE>
+    template <error_aggregation_e EA = SUM_OF_SQUARE, typename S = inline_storage<>, size_t LA = 0>
     struct config {
         static constexpr const error_aggregation_e ea {EA};
+        using storage = S;
+        static constexpr const size_t layout_alignment {LA};
     };
 
     /**
@@ -40,9 +51,9 @@ namespace neural_network_tools {
     template <size_t Inputs, size_t Outputs, size_t Training_samples, size_t Alpha = 2>
     static constexpr size_t hidden_layer_size = Training_samples / (Alpha * (Inputs + Outputs));
     
-    template <size_t SI, size_t SO, size_t SS = 1024>
+    template <size_t SI, size_t SO, size_t SS = 1024, template <size_t> typename R = gru>
     constexpr auto simple_gru() {
-        return network<config<SUM_OF_SQUARE>, input<SI>, gru<hidden_layer_size<SI, SO, SS>>, output<SO>>{};
+        return network<config<SUM_OF_SQUARE>, input<SI>, R<hidden_layer_size<SI, SO, SS>>, output<SO>>{};
     }
 
     /**
@@ -53,157 +64,227 @@ namespace neural_network_tools {
      */
     template <typename CFG, typename... T_layers>
     class network {
-    private:
-        using layers_t = tuple<T_layers...>; // The layers only store meta information and are never instantiated
-        using inputs_t = std::tuple_element_t<0, layers_t>;
-        using outputs_t = std::tuple_element_t<sizeof...(T_layers) - 1, layers_t>;
-
-        template <size_t c, typename T, typename U, typename... Ts>
-        static constexpr size_t count_weights() {
-            if constexpr (sizeof...(Ts)) {
-                return count_weights<c + (T::size + T::bias) * U::size, U, Ts...>();
-            } else {
-                return c + (T::size + T::bias) * U::size;
-            }
-        }
+    public:
+        // Layout and kernel entry points: a read only view for code that
+        // walks the layers itself, such as `ensemble`, `autotuner`,
+        // `cost_model` and `es_trainer`. All of it is a pure function of
+        // the network type.
 
-        template <size_t L, size_t N = 0>
-        struct size_offset {
-            static constexpr const size_t value {
-                size_offset<L-1, N + std::tuple_element_t<L-1, layers_t>::size>::value
-            };
-        };
+        /// Layer types, they only store meta information and are never instantiated
+        using layers_t = tuple<T_layers...>;
 
-        template <size_t N>
-        struct size_offset<0, N> {
-            static constexpr const size_t value { N };
+        /// Elements per alignment boundary in a padded layout, 1 when packed.
+        static constexpr const size_t lane {
+            CFG::layout_alignment > sizeof(state_t) ? CFG::layout_alignment / sizeof(state_t) : 1
         };
 
-        template <size_t L, size_t N = 0>
-        struct external_weight_offset {
-            static constexpr const size_t value {
-                external_weight_offset<L-1, 
-                    N +
-                    (std::tuple_element_t<L-1, layers_t>::size +
-                     std::tuple_element_t<L-1, layers_t>::bias) *
-                    std::tuple_element_t<L, layers_t>::size +
-                    std::tuple_element_t<L, layers_t>::weights_size
-                >::value
-            };
+        /// Round `n` elements up to a whole number of lanes.
+        static constexpr size_t pad(const size_t n) noexcept { return align_up(n, lane); }
+
+        /// Where one layer lives in the network buffers.
+        struct layer_layout {
+            size_t size;
+            bool bias;
+            size_t weights_size;            ///< Internal weights
+            size_t errors_size;
+            size_t state_offset;            ///< Into `accumulators` and `states`
+            size_t internal_weight_offset;
+            size_t external_weight_offset;  ///< Weights to the next layer, one padded row per state plus bias
+            size_t errors_offset;
         };
 
-        template <size_t N>
-        struct external_weight_offset<0, N> {
-            static constexpr const size_t value {
-                N + std::tuple_element_t<0, layers_t>::weights_size
-            };
-        };
+    private:
+        using inputs_t = std::tuple_element_t<0, layers_t>;
+        using outputs_t = std::tuple_element_t<sizeof...(T_layers) - 1, layers_t>;
 
-        template <size_t L, size_t N = 0>
-        struct internal_weight_offset {
-            static constexpr const size_t value {
-                internal_weight_offset<L-1,
-                    N +
-                    (std::tuple_element_t<L-1, layers_t>::size +
-                     std::tuple_element_t<L-1, layers_t>::bias) *
-                    std::tuple_element_t<L, layers_t>::size +
-                    std::tuple_element_t<L-1, layers_t>::weights_size
-                >::value
-            };
-        };
+        static_assert(CFG::layout_alignment <= CFG::storage::alignment, "Layout alignment can't exceed the storage alignment");
+        static_assert(!CFG::layout_alignment || (sizeof(accumulator_t) == sizeof(state_t) &&
+                                                 sizeof(state_t) == sizeof(weight_t) &&
+                                                 sizeof(weight_t) == sizeof(error_t)),
+                      "A padded layout needs equally sized accumulator, state, weight and error types");
+
+        /// Offsets of every layer, as prefix sums over the padded sizes.
+        static constexpr std::array<layer_layout, sizeof...(T_layers)> make_layout() noexcept {
+            std::array<layer_layout, sizeof...(T_layers)> l {{
+                { T_layers::size, T_layers::bias, T_layers::weights_size,
+                  has_errors_size<T_layers>::value ? T_layers::errors_size : 0, 0, 0, 0, 0 }...
+            }};
+            size_t so = 0, wo = 0, eo = 0;
+            for (size_t i = 0; i < l.size(); ++i) {
+                l[i].state_offset = so;
+                l[i].internal_weight_offset = wo;
+                l[i].external_weight_offset = wo + pad(l[i].weights_size);
+                l[i].errors_offset = eo;
+                so += pad(l[i].size);
+                wo = l[i].external_weight_offset + (i + 1 < l.size() ? (l[i].size + l[i].bias) * pad(l[i + 1].size) : 0);
+                eo += pad(l[i].errors_size);
+            }
+            return l;
+        }
 
-        template <size_t N>
-        struct internal_weight_offset<0, N> {
-            static constexpr const size_t value { N };
-        };
+    public:
+        /// Computed once per network type, everything that walks the layers indexes into it.
+        static constexpr const std::array<layer_layout, sizeof...(T_layers)> layout { make_layout() };
 
+        /**
+         * @brief Activate the clusters of layer `I` alone, with the planned
+         * kernel variant.
+         */
+        template <size_t I>
+        static constexpr void activate_layer(accumulator_t *const accumulators, state_t *const states, const weight_t *const weights) noexcept {
+            constexpr const auto so = layout[I].state_offset;
+            constexpr const auto iwo = layout[I].internal_weight_offset;
+            // std::cout << "Activating layer " << I << ", so=" << so << ", iwo=" << iwo << '\n';
+            using T = std::tuple_element_t<I, layers_t>;
+            if constexpr (has_kernel_variants<T>::value) {
+                T::activate_kernel(plan.cluster[I], &accumulators[so], &states[so], &weights[iwo]);
+            } else {
+                T::activate(&accumulators[so], &states[so], &weights[iwo]);
+            }
+        }
 
-        template <size_t L, size_t N = 0>
-        struct errors_offset {
-            static constexpr const size_t value {
-                errors_offset<L-1,
-                              N + std::tuple_element_t<L-1, layers_t>::errors_size
-                >::value
-            };
-        };
+        /**
+         * @brief Add the states of layer `I` to the accumulators of layer
+         * `I + 1`, using dense kernel variant `k`.
+         */
+        template <size_t I>
+        static constexpr void connect(const uint8_t k, accumulator_t *const accumulators, const state_t *const states, const weight_t *const weights) noexcept {
+            using T = std::tuple_element_t<I, layers_t>;
+            // Rows run into the padding of a padded layout, which holds
+            // zero weights. Saves the kernel a peel loop for the tail.
+            dense<T::size, pad(std::tuple_element_t<I+1, layers_t>::size), T::bias>(k,
+                &accumulators[layout[I + 1].state_offset],
+                &states[layout[I].state_offset],
+                &weights[layout[I].external_weight_offset]);
+        }
 
-        template <size_t N>
-        struct errors_offset<0, N> {
-            static constexpr const size_t value { N };
-        };
+        /**
+         * @brief Call `f(offset, count)` for each run of real (non padding)
+         * weights, in buffer order.
+         */
+        template <typename F>
+        static constexpr void for_each_weight_run(F&& f) {
+            for (size_t i = 0; i < layout.size(); ++i) {
+                if (layout[i].weights_size > 0) f(layout[i].internal_weight_offset, layout[i].weights_size);
+                if (i + 1 < layout.size()) {
+                    for (size_t r = 0; r < layout[i].size + layout[i].bias; ++r) {
+                        f(layout[i].external_weight_offset + r * pad(layout[i + 1].size), layout[i + 1].size);
+                    }
+                }
+            }
+        }
 
+        /**
+         * @brief Call `f(offset, count)` for each layer's real states, in buffer order.
+         */
+        template <typename F>
+        static constexpr void for_each_state_run(F&& f) {
+            for (const auto& l : layout) f(l.state_offset, l.size);
+        }
 
+    private:
+        /// Weights between layers, with padded or packed rows.
+        static constexpr size_t count_weights(const bool padded) noexcept {
+            size_t c = 0;
+            for (size_t i = 0; i + 1 < layout.size(); ++i) {
+                c += (layout[i].size + layout[i].bias) * (padded ? pad(layout[i + 1].size) : layout[i + 1].size);
+            }
+            return c;
+        }
 
+        /**
+         * @brief Walk the layers from layer `F` on, reading and writing the
+         * given state buffers.
+         * 
+         * Taking the buffers as arguments lets the same layer walk run on the
+         * network itself as well as on a detached `snapshot`.
+         */
+        template <size_t F = 0>
+        static constexpr void activate_next(accumulator_t *const accumulators, state_t *const states, const weight_t *const weights) {
+            activate_layers<F>(std::make_index_sequence<sizeof...(T_layers) - F> {}, accumulators, states, weights);
+        }
 
-        template <size_t I, typename... Tp>
-        constexpr std::enable_if_t<(I == sizeof...(T_layers)), void>
-        activate_next() {}
+        template <size_t F, size_t... I>
+        static constexpr void activate_layers(std::index_sequence<I...>, accumulator_t *const accumulators, state_t *const states, const weight_t *const weights) {
+            (activate_step<F + I>(accumulators, states, weights), ...);
+        }
 
-        template <size_t I = 0, typename... Tp>
-        constexpr std::enable_if_t<(I < sizeof...(T_layers)), void>
-        activate_next() {
-            constexpr const auto so = size_offset<I>::value;
-            constexpr const auto iwo = internal_weight_offset<I>::value;
-            // std::cout << "Activating layer " << I << ", so=" << so << ", iwo=" << iwo << '\n';
-            std::tuple_element_t<I, layers_t>::activate(&accumulators[so],
-                                                        &states[so],
-                                                        &weights[iwo]);
+        /// Layer `I` and its connection to the next layer.
+        template <size_t I>
+        static constexpr void activate_step(accumulator_t *const accumulators, state_t *const states, const weight_t *const weights) {
+            activate_layer<I>(accumulators, states, weights);
 
             if constexpr (I < (sizeof...(T_layers) - 1)) {
-                constexpr const auto sol = so + std::tuple_element_t<I, layers_t>::size;
-                constexpr const auto ewo = external_weight_offset<I>::value;
-                constexpr const auto nso = size_offset<I+1>::value;
-                constexpr const auto nsol = nso + std::tuple_element_t<I+1, layers_t>::size;
-
-                size_t k = ewo;
-                for (auto i = so; i < sol; ++i) {
-                    for (auto j = nso; j < nsol; ++j) {
-                        accumulators[j] += states[i] * weights[k++];
-                    }
-                }
-                if (std::tuple_element_t<I, layers_t>::bias) {
-                    for (auto j = nso; j < nsol; ++j) {
-                        accumulators[j] += weights[k++];
-                    }
-                }
+                connect<I>(plan.dense[I], accumulators, states, weights);
             }
-            activate_next<I + 1>();
         }
 
-        template <size_t I, typename... Tp>
-        constexpr std::enable_if_t<(I == sizeof...(T_layers)), void>
-        check_next() {}
+        template <size_t... I>
+        constexpr void check_layers(std::index_sequence<I...>) {
+            (std::tuple_element_t<I, layers_t>::check(&states[layout[I].state_offset],
+                                                      &errors[layout[I].errors_offset]), ...);
+        }
 
-        template <size_t I = 0, typename... Tp>
-        constexpr std::enable_if_t<(I < sizeof...(T_layers)), void>
-        check_next() {
-            constexpr const auto so = size_offset<I>::value;
-            constexpr const auto eo = errors_offset<I>::value;
-            std::tuple_element_t<I, layers_t>::check(&states[so],
-                                                     &errors[eo]);
+        template <typename T, size_t N>
+        using detached_array_t = typename CFG::storage::detached::template array<T, N>;
 
-            check_next<I + 1>();
+    public:
+        /// Storage policy of the buffers, see storage.hpp
+        using storage_t = typename CFG::storage;
+
+        template <typename T, size_t N>
+        using array_t = typename storage_t::template array<T, N>;
+
+        constexpr network() noexcept(std::is_nothrow_default_constructible_v<array_t<weight_t, 1>>) {
+            set_weights();
         }
 
-    public:
-        constexpr network() noexcept {
+        /**
+         * @brief Construct a network with its buffers taken from a slab, for
+         * use with `arena_storage`.
+         * 
+         * @param s Slab, must outlive the network
+         */
+        explicit network(slab& s) : accumulators { s }, states { s }, errors { s }, weights { s } {
             set_weights();
         }
+
+        constexpr network(const network& o)
+            : accumulators { o.accumulators }, states { o.states }, errors { o.errors }, weights { o.weights },
+              error { o.error }, step { o.step }, last_checked { o.last_checked }, last_learned { o.last_learned } {}
+
+        constexpr network(network&& o) noexcept
+            : accumulators { std::move(o.accumulators) }, states { std::move(o.states) }, errors { std::move(o.errors) }, weights { std::move(o.weights) },
+              error { o.error }, step { o.step }, last_checked { o.last_checked }, last_learned { o.last_learned } {}
         
+        static constexpr const size_t layers_size { sizeof...(T_layers) };
+
+        /// Kernel variant per layer, shared by all networks of this type. See autotune.hpp.
+        static inline kernel_plan<layers_size> plan {};
+
         static constexpr const size_t inputs_size { inputs_t::size };
         static constexpr const size_t outputs_size { outputs_t::size };
 
-        static constexpr const size_t accumulators_size { (T_layers::size + ...) };
-        static constexpr const size_t states_size { (T_layers::size + ...) };
-        static constexpr const size_t errors_size { ((has_errors_size<T_layers>::value ? T_layers::errors_size : 0) + ...) };
-        static constexpr const size_t external_weights_size { count_weights<0, T_layers...>() };
-        static constexpr const size_t internal_weights_size { (T_layers::weights_size + ... ) };
+        // Buffer sizes, including any layout padding
+        static constexpr const size_t accumulators_size { (pad(T_layers::size) + ...) };
+        static constexpr const size_t states_size { (pad(T_layers::size) + ...) };
+        static constexpr const size_t errors_size { (pad(has_errors_size<T_layers>::value ? T_layers::errors_size : 0) + ...) };
+        static constexpr const size_t external_weights_size { count_weights(true) };
+        static constexpr const size_t internal_weights_size { (pad(T_layers::weights_size) + ... ) };
         static constexpr const size_t weights_size { external_weights_size + internal_weights_size };
 
-        std::array<accumulator_t,   accumulators_size>  accumulators {};
-        std::array<state_t,         states_size>        states {};
-        std::array<error_t,         errors_size>        errors {};
-        std::array<weight_t,        weights_size>       weights {};
+        // Sizes without layout padding, as saved
+        static constexpr const size_t packed_states_size { (T_layers::size + ...) };
+        static constexpr const size_t packed_weights_size { count_weights(false) + (T_layers::weights_size + ... ) };
+        static constexpr const bool packed { lane == 1 };
+
+        static constexpr const size_t hidden_offset { pad(inputs_t::size) };
+        static constexpr const size_t outputs_offset { layout.back().state_offset };
+
+        array_t<accumulator_t,  accumulators_size>  accumulators {};
+        array_t<state_t,        states_size>        states {};
+        array_t<error_t,        errors_size>        errors {};
+        array_t<weight_t,       weights_size>       weights {};
         error_t error {};
         size_t step { 0 };
         size_t last_checked { 0 };
@@ -211,21 +292,59 @@ namespace neural_network_tools {
 
         //TODO: Convert these to use `span`s with proper iterator support
         accumulator_t *const inputs = accumulators.data();
-        state_t *const outputs = &states[states_size - outputs_size];
+        state_t *const outputs = &states[outputs_offset];
 
-        static constexpr const size_t states_bytes { states_size * sizeof(state_t) };
-        static constexpr const size_t weights_bytes { weights_size * sizeof(weight_t) };
+        static constexpr const size_t states_bytes { packed_states_size * sizeof(state_t) };
+        static constexpr const size_t weights_bytes { packed_weights_size * sizeof(weight_t) };
         static constexpr const size_t step_bytes { sizeof(decltype(step)) };
         static constexpr const size_t last_checked_bytes { sizeof(decltype(last_checked)) };
         static constexpr const size_t last_learned_bytes { sizeof(decltype(last_learned)) };
         static constexpr const size_t save_bytes { states_bytes + weights_bytes + step_bytes + last_checked_bytes + last_learned_bytes };
 
+        /// Bytes of buffer space per network, eg to size a `slab`.
+        static constexpr const size_t storage_bytes {
+            storage_t::template footprint<accumulator_t, accumulators_size> +
+            storage_t::template footprint<state_t, states_size> +
+            storage_t::template footprint<error_t, errors_size> +
+            storage_t::template footprint<weight_t, weights_size>
+        };
+
+        /**
+         * @brief Detached copy of the volatile network state.
+         * 
+         * Holds only `accumulators`, `states` and `step`, the weights stay
+         * with the network that created it. Use it to run what-if rollouts
+         * without touching (or copying) the network itself.
+         * 
+         * The buffers follow the storage policy's `detached` policy: inline
+         * for inline networks, heap blocks for owned and arena networks.
+         */
+        struct snapshot {
+            detached_array_t<accumulator_t,   accumulators_size>  accumulators {};
+            detached_array_t<state_t,         states_size>        states {};
+            size_t step { 0 };
+
+            constexpr accumulator_t *inputs() noexcept { return accumulators.data(); }
+            constexpr const state_t *outputs() const noexcept { return &states[outputs_offset]; }
+        };
+
 
         /**
          * @brief Predict the next output values
          */
         constexpr void activate() {
-            activate_next();
+            activate_next(accumulators.data(), states.data(), weights.data());
+            ++step;
+        }
+
+        /**
+         * @brief Predict the next output values using an external weight set,
+         * eg one published through `rcu_weights`.
+         * 
+         * @param w Weights in the buffer layout of this network
+         */
+        constexpr void activate(const weight_t *const w) noexcept {
+            activate_next(accumulators.data(), states.data(), w);
             ++step;
         }
 
@@ -234,7 +353,7 @@ namespace neural_network_tools {
          * 
          */
         constexpr void check() {
-            check_next();
+            check_layers(std::make_index_sequence<sizeof...(T_layers)> {});
             error = error_aggregation<CFG::ea>::run(errors);
             last_checked = step;
         }
@@ -246,28 +365,234 @@ namespace neural_network_tools {
         constexpr void train() {
             if (step <= last_learned) return; // Don't repeat a learning step
             if (last_checked < step) check(); // Make sure our error data is as actual as possible.
-            
+            learn();
+        }
+
+        /**
+         * @brief Optimize weights based on the errors of the last `check()`,
+         * however old. For schedules that decide themselves when to check,
+         * see schedule.hpp.
+         *
+         * Until the training library is ported this only marks the step as
+         * learned, the weights don't change.
+         */
+        constexpr void learn() {
+            if (step <= last_learned) return; // Don't repeat a learning step
+
             //TODO: Training library port entry point
 
             last_learned = step;
         }
 
+        /**
+         * @brief Fork the current volatile state into a snapshot.
+         */
+        constexpr snapshot fork() const noexcept {
+            snapshot snap {};
+            std::copy(accumulators.begin(), accumulators.end(), snap.accumulators.begin());
+            std::copy(states.begin(), states.end(), snap.states.begin());
+            snap.step = step;
+            return snap;
+        }
+
+        /**
+         * @brief Return the network to a previously forked state.
+         * 
+         * @param snap Snapshot to restore from
+         */
+        constexpr void restore(const snapshot& snap) noexcept {
+            std::copy(snap.accumulators.begin(), snap.accumulators.end(), accumulators.begin());
+            std::copy(snap.states.begin(), snap.states.end(), states.begin());
+            step = snap.step;
+        }
+
+        /**
+         * @brief Predict the next output values of a snapshot, using the
+         * weights of this network.
+         * 
+         * @param snap Snapshot to advance one step
+         */
+        constexpr void activate(snapshot& snap) const noexcept {
+            activate_next(snap.accumulators.data(), snap.states.data(), weights.data());
+            ++snap.step;
+        }
+
+        /**
+         * @brief Run a snapshot `k` steps ahead.
+         * 
+         * Before each step `feed(snap, i)` is called to set the inputs for
+         * step `i` of the rollout.
+         * 
+         * @param snap  Snapshot to advance
+         * @param k     Number of steps
+         * @param feed  Input callback
+         */
+        template <typename F>
+        constexpr void rollout(snapshot& snap, const size_t k, F&& feed) const {
+            for (size_t i = 0; i < k; ++i) {
+                feed(snap, i);
+                activate(snap);
+            }
+        }
+
+        /**
+         * @brief Run a range of snapshots `k` steps ahead, in lock step.
+         * 
+         * All snapshots take step `i` before any takes step `i + 1`, so the
+         * weights stay hot in cache over the whole batch.
+         * 
+         * @param first First snapshot
+         * @param last  One past the last snapshot
+         * @param k     Number of steps
+         * @param feed  Input callback, called as `feed(snap, i)`
+         */
+        template <typename It, typename F>
+        constexpr void rollout(It first, It last, const size_t k, F&& feed) const {
+            for (size_t i = 0; i < k; ++i) {
+                for (auto it = first; it != last; ++it) {
+                    feed(*it, i);
+                    activate(*it);
+                }
+            }
+        }
+
+        /**
+         * @brief Run `t` consecutive steps, same as `t` times setting the
+         * inputs and calling `activate()`.
+         * 
+         * The input layer holds no state between steps, so its states for a
+         * whole run of steps are known up front. Their projection onto the
+         * first hidden layer then becomes one cache blocked matrix-matrix
+         * product over the run instead of a matrix-vector product per step,
+         * and only the layers from the first hidden one on run step by step.
+         * The input layer's dense kernel from `plan` is not used.
+         * 
+         * @param in    `t` rows of `inputs_size` inputs, row major
+         * @param out   `t` rows of `outputs_size` outputs, row major
+         * @param t     Number of steps
+         */
+        constexpr void activate_sequence(const accumulator_t *const in, state_t *const out, const size_t t) noexcept {
+            using L0 = std::tuple_element_t<0, layers_t>;
+            using L1 = std::tuple_element_t<1, layers_t>;
+            static_assert(!L0::recurrent, "The input layer must not be recurrent to precompute its projection");
+
+            constexpr const size_t row { pad(L1::size) };
+            constexpr const auto so1 = layout[1].state_offset;
+            constexpr const auto ewo = layout[0].external_weight_offset;
+            // Steps per block: the projections of a block stay in L1
+            constexpr const size_t block { std::clamp<size_t>(8192 / (row * sizeof(accumulator_t)), 1, 64) };
+            constexpr const size_t columns { 256 };
+
+            std::array<state_t, block * L0::size> s0;
+            std::array<accumulator_t, block * row> projection;
+
+            for (size_t t0 = 0; t0 < t; t0 += block) {
+                const size_t n = std::min(block, t - t0);
+
+                for (size_t k = 0; k < n; ++k) {
+                    std::copy(in + (t0 + k) * inputs_size, in + (t0 + k + 1) * inputs_size, accumulators.begin());
+                    activate_layer<0>(accumulators.data(), states.data(), weights.data());
+                    std::copy(states.begin(), states.begin() + L0::size, s0.begin() + k * L0::size);
+                }
+
+                // Same summation order per element as `connect<0>()`
+                std::fill(projection.begin(), projection.begin() + n * row, 0);
+                const weight_t *const w = &weights[ewo];
+                for (size_t jt = 0; jt < row; jt += columns) {
+                    const size_t je = std::min(row, jt + columns);
+                    for (size_t i = 0; i < L0::size; ++i) {
+                        const weight_t *const wr = w + i * row;
+                        for (size_t k = 0; k < n; ++k) {
+                            const state_t x = s0[k * L0::size + i];
+                            accumulator_t *const p = &projection[k * row];
+                            for (size_t j = jt; j < je; ++j) {
+                                p[j] += x * wr[j];
+                            }
+                        }
+                    }
+                    if constexpr (L0::bias) {
+                        const weight_t *const wb = w + L0::size * row;
+                        for (size_t k = 0; k < n; ++k) {
+                            for (size_t j = jt; j < je; ++j) {
+                                projection[k * row + j] += wb[j];
+                            }
+                        }
+                    }
+                }
+
+                for (size_t k = 0; k < n; ++k) {
+                    for (size_t j = 0; j < row; ++j) {
+                        accumulators[so1 + j] += projection[k * row + j];
+                    }
+                    activate_next<1>(accumulators.data(), states.data(), weights.data());
+                    ++step;
+                    std::copy(outputs, outputs + outputs_size, out + (t0 + k) * outputs_size);
+                }
+            }
+        }
+
+        /**
+         * @brief `activate_sequence()` over arrays of `T` steps.
+         */
+        template <size_t T>
+        constexpr void activate_sequence(const accumulator_t (&in)[T][inputs_size], state_t (&out)[T][outputs_size]) noexcept {
+            activate_sequence(&in[0][0], &out[0][0], T);
+        }
+
         constexpr void set_weights() noexcept {
-            for (size_t i = 0; i < weights_size; ++i) {
-                weights[i] = -1 + i * (2.0 / weights_size);
+            if constexpr (packed) {
+                for (size_t i = 0; i < weights_size; ++i) {
+                    weights[i] = -1 + i * (2.0 / weights_size);
+                }
+            } else {
+                // Same values as the packed layout, padding stays zero
+                size_t q = 0;
+                for_each_weight_run([&](const size_t o, const size_t n) {
+                    for (size_t i = 0; i < n; ++i, ++q) {
+                        weights[o + i] = -1 + q * (2.0 / packed_weights_size);
+                    }
+                });
             }
-            // std::default_random_engine e { 1u }; // Will result in the same 'random' generation each compile
-            // std::uniform_real_distribution<> rnd(-1.0f, 1.0f);
-            // for (auto& w : weights) w = rnd(e);
         }
 
-        constexpr void set_weights(const std::array<weight_t, weights_size>& w) noexcept {
-            std::copy(w.begin(), w.end(), weights.begin());
+        /**
+         * @brief Set all weights uniform in [-1, 1) from a Philox stream.
+         *
+         * Weight `q` of the packed layout is value `q` of stream
+         * (`seed`, `instance`), so the result depends only on those two,
+         * not on the layout padding, and every network of an ensemble or
+         * worker gets its own reproducible set.
+         */
+        void set_weights_random(const uint64_t seed, const uint64_t instance = 0) noexcept {
+            const extra_math::philox4x32 rng { seed, instance };
+            size_t q = 0;
+            for_each_weight_run([&](const size_t o, const size_t n) {
+                rng.fill_uniform<weight_t>(&weights[o], n, q, -1, 1);
+                q += n;
+            });
+        }
+
+        /**
+         * @brief Set all weights from a packed (unpadded) weight array.
+         */
+        constexpr void set_weights(const std::array<weight_t, packed_weights_size>& w) noexcept {
+            if constexpr (packed) {
+                std::copy(w.begin(), w.end(), weights.begin());
+            } else {
+                size_t q = 0;
+                for_each_weight_run([&](const size_t o, const size_t n) {
+                    std::copy(&w[q], &w[q] + n, &weights[o]);
+                    q += n;
+                });
+            }
         }
 
         /**
          * @brief Save the current network state (minus inputs) to a byte buffer.
          * 
+         * The buffer always holds the packed layout, so a padded network saves
+         * the same bytes as its packed equivalent.
+         * 
          * @param dst   Destination buffer
          * @param free  Buffer free size for check
          * @return constexpr int    bytes written
@@ -275,11 +600,24 @@ namespace neural_network_tools {
         constexpr int save(void *const dst, const size_t free = save_bytes) noexcept {
             if (free < save_bytes) return -1;
 
-            std::memcpy(dst, states.data(), states_bytes);
-            std::memcpy(dst + states_bytes, weights.data(), weights_bytes);
-            std::memcpy(dst + states_bytes + weights_bytes, &step, step_bytes);
-            std::memcpy(dst + states_bytes + weights_bytes + step_bytes, &last_checked, last_checked_bytes);
-            std::memcpy(dst + states_bytes + weights_bytes + step_bytes + last_checked_bytes, &last_learned, last_learned_bytes);
+            char *const d = static_cast<char *>(dst);
+            if constexpr (packed) {
+                std::memcpy(d, states.data(), states_bytes);
+                std::memcpy(d + states_bytes, weights.data(), weights_bytes);
+            } else {
+                size_t p = 0;
+                for_each_state_run([&](const size_t o, const size_t n) {
+                    std::memcpy(d + p, &states[o], n * sizeof(state_t));
+                    p += n * sizeof(state_t);
+                });
+                for_each_weight_run([&](const size_t o, const size_t n) {
+                    std::memcpy(d + p, &weights[o], n * sizeof(weight_t));
+                    p += n * sizeof(weight_t);
+                });
+            }
+            std::memcpy(d + states_bytes + weights_bytes, &step, step_bytes);
+            std::memcpy(d + states_bytes + weights_bytes + step_bytes, &last_checked, last_checked_bytes);
+            std::memcpy(d + states_bytes + weights_bytes + step_bytes + last_checked_bytes, &last_learned, last_learned_bytes);
             return save_bytes;
         }
 
@@ -289,11 +627,24 @@ namespace neural_network_tools {
          * @param src Source buffer
          */
         constexpr void restore(const void *const src) {
-            std::memcpy(states.data(), src, states_bytes);
-            std::memcpy(weights.data(), src + states_bytes, weights_bytes);
-            std::memcpy(&step, src + states_bytes + weights_bytes, step_bytes);
-            std::memcpy(&last_checked, src + states_bytes + weights_bytes + step_bytes, last_checked_bytes);
-            std::memcpy(&last_learned, src + states_bytes + weights_bytes + step_bytes + last_checked_bytes, last_learned_bytes);
+            const char *const d = static_cast<const char *>(src);
+            if constexpr (packed) {
+                std::memcpy(states.data(), d, states_bytes);
+                std::memcpy(weights.data(), d + states_bytes, weights_bytes);
+            } else {
+                size_t p = 0;
+                for_each_state_run([&](const size_t o, const size_t n) {
+                    std::memcpy(&states[o], d + p, n * sizeof(state_t));
+                    p += n * sizeof(state_t);
+                });
+                for_each_weight_run([&](const size_t o, const size_t n) {
+                    std::memcpy(&weights[o], d + p, n * sizeof(weight_t));
+                    p += n * sizeof(weight_t);
+                });
+            }
+            std::memcpy(&step, d + states_bytes + weights_bytes, step_bytes);
+            std::memcpy(&last_checked, d + states_bytes + weights_bytes + step_bytes, last_checked_bytes);
+            std::memcpy(&last_learned, d + states_bytes + weights_bytes + step_bytes + last_checked_bytes, last_learned_bytes);
         }
     };
 }
\ No newline at end of file
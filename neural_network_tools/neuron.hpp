@@ -3,20 +3,100 @@
 #include "forward_declarations.hpp"
 #include "activation.hpp"
 
+#include <utility>
+
 // #include <iostream>
 
 namespace neural_network_tools {
 
-    template <size_t S = 1, bool B = false, size_t W = 0, size_t E = 0>
+    template <size_t S = 1, bool B = false, size_t W = 0, size_t E = 0, bool R = false>
     struct base_cluster {
         static constexpr const size_t size { S };
         static constexpr const size_t weights_size { W };
         static constexpr const size_t errors_size { E };
         static constexpr const bool bias { B };
+        static constexpr const bool recurrent { R }; ///< States depend on the previous step's states
 
         static constexpr void check(state_t *const s __attribute__((unused)), error_t *const e __attribute__((unused))) {}
     };
 
+    /**
+     * @brief State visitor that does nothing, the default for clusters that
+     * take one.
+     */
+    struct ignore_state {
+        constexpr void operator()(const state_t) const noexcept {}
+    };
+
+    template <typename T, typename = int>
+    struct has_state_visitor : std::false_type { };
+
+    template <typename T>
+    struct has_state_visitor <T, decltype(T::activate(std::declval<accumulator_t *>(), std::declval<state_t *>(),
+                                                      std::declval<const weight_t *>(), ignore_state {}), 0)> : std::true_type { };
+
+    /**
+     * @brief Activate cluster `T` and call `visit(state)` with each of its
+     * new states, in order.
+     * 
+     * Clusters that take a visitor call it from inside their activation
+     * loop, so filters can gather statistics without another pass over the
+     * states. Others are followed by a separate pass.
+     */
+    template <typename T, typename F>
+    constexpr void activate_visiting(accumulator_t *const a, state_t *const s, const weight_t *const w, F&& visit) noexcept {
+        if constexpr (has_state_visitor<T>::value) {
+            T::activate(a, s, w, std::forward<F>(visit));
+        } else {
+            T::activate(a, s, w);
+            for (size_t i = 0; i < T::size; ++i) {
+                visit(s[i]);
+            }
+        }
+    }
+
+    template <typename T, size_t M, typename = int>
+    struct has_activate_lanes : std::false_type { };
+
+    template <typename T, size_t M>
+    struct has_activate_lanes <T, M, decltype((void) &T::template activate_lanes<M>, 0)> : std::true_type { };
+
+    /**
+     * @brief Activate `M` interleaved instances of cluster `T` in one pass.
+     * 
+     * Element `i` of lane `m` lives at `i * M + m`, for accumulators, states
+     * and weights alike. Clusters providing `activate_lanes<M>()` run
+     * vectorised across the lanes, others are gathered, activated one lane at
+     * a time and scattered back.
+     * 
+     * @tparam M    Lane count
+     * @tparam T    Cluster type
+     */
+    template <size_t M, typename T>
+    constexpr void activate_interleaved(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+        if constexpr (has_activate_lanes<T, M>::value) {
+            T::template activate_lanes<M>(a, s, w);
+        } else {
+            std::array<accumulator_t, T::size> la {};
+            std::array<state_t, T::size> ls {};
+            std::array<weight_t, T::weights_size> lw {};
+            for (size_t m = 0; m < M; ++m) {
+                for (size_t i = 0; i < T::size; ++i) {
+                    la[i] = a[i * M + m];
+                    ls[i] = s[i * M + m];
+                }
+                for (size_t i = 0; i < T::weights_size; ++i) {
+                    lw[i] = w[i * M + m];
+                }
+                T::activate(la.data(), ls.data(), lw.data());
+                for (size_t i = 0; i < T::size; ++i) {
+                    a[i * M + m] = la[i];
+                    s[i * M + m] = ls[i];
+                }
+            }
+        }
+    }
+
     /**
      * @brief A simple non-recursive neuron cluster model.
      * 
@@ -34,10 +114,20 @@ namespace neural_network_tools {
         constexpr operator base&() noexcept { return *static_cast<base *const>(this); }
         constexpr operator const base&() const noexcept { return *static_cast<const base *const>(this); }
 
-        static constexpr void activate(accumulator_t *const a, state_t *const s, weight_t *const w __attribute__((unused))) noexcept {
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            activate(a, s, w, ignore_state {});
+        }
+
+        /**
+         * @brief Activate, calling `visit(state)` for each new state. See
+         * `activate_visiting()`.
+         */
+        template <typename F>
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w __attribute__((unused)), F&& visit) noexcept {
             for (size_t i = 0; i < S; ++i) {
                 // std::cout << "Activating input  (" << &s[i] << " <-- " << &a[i] << ") " << s[i] << " <-- " << a[i] << ": ";
                 s[i] = activation<TA>::run(a[i]);
+                visit(s[i]);
                 // std::cout << s[i] << '\n';
             }
             if constexpr (C) {
@@ -49,6 +139,18 @@ namespace neural_network_tools {
                 }
             }
         }
+
+        template <size_t M>
+        static constexpr void activate_lanes(accumulator_t *const a, state_t *const s, const weight_t *const w __attribute__((unused))) noexcept {
+            for (size_t i = 0; i < S * M; ++i) {
+                s[i] = activation<TA>::run(a[i]);
+            }
+            if constexpr (C) {
+                for (size_t i = 0; i < S * M; ++i) {
+                    a[i] = 0;
+                }
+            }
+        }
     };
 
     /**
@@ -69,6 +171,12 @@ namespace neural_network_tools {
     template <size_t S, activation_e TA = PASSTHROUGH>
     using output = simple<S, TA, false, true>; // Outputs don't need bias (it's ignored anyway, but adds dead weights)
 
+    enum gru_kernel_e : uint8_t {
+        GRU_FUSED,          ///< All gates of a neuron in one pass
+        GRU_GATE_PASSES,    ///< One pass over all neurons per gate
+        gru_kernel_count
+    };
+
     /**
      * @brief Recurrent neuron cluster, based on the GRU model.
      * 
@@ -87,16 +195,25 @@ namespace neural_network_tools {
               bool GB = false,
               bool B = true,
               bool C = true>
-    struct gru : public base_cluster<S, B, (GB ? 9 : 6) * S> { // GRU, but in SoA layout. Is about 20% faster.
-        using base =    base_cluster<S, B, (GB ? 9 : 6) * S>;
+    struct gru : public base_cluster<S, B, (GB ? 9 : 6) * S, 0, true> { // GRU, but in SoA layout. Is about 20% faster.
+        using base =    base_cluster<S, B, (GB ? 9 : 6) * S, 0, true>;
         constexpr operator base&() noexcept { return *static_cast<base *const>(this); }
         constexpr operator const base&() const noexcept { return *static_cast<const base *const>(this); }
 
-        static constexpr void activate(accumulator_t *const a, state_t *const s, weight_t *const w) noexcept {
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            activate(a, s, w, ignore_state {});
+        }
+
+        /**
+         * @brief Activate, calling `visit(state)` for each new state. See
+         * `activate_visiting()`.
+         */
+        template <typename F>
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w, F&& visit) noexcept {
             auto *_w = w;
             for (size_t i = 0; i < S; ++i) {
                 // std::cout << "Activating GRU    (" << &s[i] << " <-- " << &a[i] << ") " << s[i] << " <-- " << a[i] << ": ";
-                if constexpr (GB) {
+                if constexpr (!GB) {
                     const auto reset_gate  = activation<TRA>::run(_w[0] * a[i] + _w[1] * s[i]);
                     const auto update_gate = activation<TUA>::run(_w[2] * a[i] + _w[3] * s[i]);
                     const auto new_state   = activation<TA >::run(_w[4] * a[i] + _w[5] * (reset_gate * s[i]));
@@ -109,6 +226,7 @@ namespace neural_network_tools {
                     _w += 9;
                     s[i] = (1 - update_gate) * s[i] + update_gate * new_state;
                 }
+                visit(s[i]);
                 // std::cout << s[i] << '\n';
             }
             if constexpr (C) {
@@ -117,7 +235,293 @@ namespace neural_network_tools {
                 }
             }
         }
+
+        static constexpr const size_t kernel_count { gru_kernel_count };
+
+        /**
+         * @brief Same as `activate()`, with the gates evaluated in separate
+         * passes over the neurons. Gives the compiler simpler loops to work
+         * with at the cost of two temporary arrays.
+         */
+        static constexpr void activate_gate_passes(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            constexpr const size_t stride { GB ? 9 : 6 };
+            std::array<state_t, S> reset_gate;
+            std::array<state_t, S> update_gate;
+            for (size_t i = 0; i < S; ++i) {
+                const auto *_w = w + i * stride;
+                if constexpr (!GB) {
+                    reset_gate[i] = activation<TRA>::run(_w[0] * a[i] + _w[1] * s[i]);
+                } else {
+                    reset_gate[i] = activation<TRA>::run(_w[0] * a[i] + _w[1] * s[i] + _w[2]);
+                }
+            }
+            for (size_t i = 0; i < S; ++i) {
+                const auto *_w = w + i * stride;
+                if constexpr (!GB) {
+                    update_gate[i] = activation<TUA>::run(_w[2] * a[i] + _w[3] * s[i]);
+                } else {
+                    update_gate[i] = activation<TUA>::run(_w[3] * a[i] + _w[4] * s[i] + _w[5]);
+                }
+            }
+            for (size_t i = 0; i < S; ++i) {
+                const auto *_w = w + i * stride;
+                if constexpr (!GB) {
+                    const auto new_state = activation<TA >::run(_w[4] * a[i] + _w[5] * (reset_gate[i] * s[i]));
+                    s[i] = (1 - update_gate[i]) * s[i] + update_gate[i] * new_state;
+                } else {
+                    const auto new_state = activation<TA>::run(_w[6] * a[i] + _w[7] * (reset_gate[i] * s[i]) + _w[8]);
+                    s[i] = (1 - update_gate[i]) * s[i] + update_gate[i] * new_state;
+                }
+            }
+            if constexpr (C) {
+                for (size_t i = 0; i < S; ++i) {
+                    a[i] = 0;
+                }
+            }
+        }
+
+        /**
+         * @brief Run kernel variant `k` (a `gru_kernel_e`), chosen at runtime.
+         */
+        static constexpr void activate_kernel(const uint8_t k, accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            if (k == GRU_GATE_PASSES) {
+                activate_gate_passes(a, s, w);
+            } else {
+                activate(a, s, w);
+            }
+        }
+
+        template <size_t M>
+        static constexpr void activate_lanes(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            constexpr const size_t stride { GB ? 9 : 6 };
+            for (size_t i = 0; i < S; ++i) {
+                const auto *_w = w + i * stride * M;
+                auto *_a = a + i * M;
+                auto *_s = s + i * M;
+                // The inner loop runs across lanes, all gate weights are contiguous per lane.
+                for (size_t m = 0; m < M; ++m) {
+                    if constexpr (!GB) {
+                        const auto reset_gate  = activation<TRA>::run(_w[0 * M + m] * _a[m] + _w[1 * M + m] * _s[m]);
+                        const auto update_gate = activation<TUA>::run(_w[2 * M + m] * _a[m] + _w[3 * M + m] * _s[m]);
+                        const auto new_state   = activation<TA >::run(_w[4 * M + m] * _a[m] + _w[5 * M + m] * (reset_gate * _s[m]));
+                        _s[m] = (1 - update_gate) * _s[m] + update_gate * new_state;
+                    } else {
+                        const auto reset_gate  = activation<TRA>::run(_w[0 * M + m] * _a[m] + _w[1 * M + m] * _s[m] + _w[2 * M + m]);
+                        const auto update_gate = activation<TUA>::run(_w[3 * M + m] * _a[m] + _w[4 * M + m] * _s[m] + _w[5 * M + m]);
+                        const auto new_state   = activation<TA>::run(_w[6 * M + m] * _a[m] + _w[7 * M + m] * (reset_gate * _s[m]) + _w[8 * M + m]);
+                        _s[m] = (1 - update_gate) * _s[m] + update_gate * new_state;
+                    }
+                }
+            }
+            if constexpr (C) {
+                for (size_t i = 0; i < S * M; ++i) {
+                    a[i] = 0;
+                }
+            }
+        }
     };
 
-    // TODO: Add a few GRU variants with less internal weights: https://arxiv.org/pdf/1701.05923.pdf
+    /**
+     * @brief Gate inputs of the reduced GRU variants from
+     * https://arxiv.org/pdf/1701.05923.pdf
+     */
+    enum gru_variant_e {
+        GRU1,   ///< Gates see the previous state and a bias
+        GRU2,   ///< Gates see the previous state only
+        GRU3    ///< Gates are a bias only
+    };
+
+    /**
+     * @brief Recurrent neuron cluster, GRU with reduced gates. Same layout
+     * and interface as `gru`, see the `gru1`, `gru2` and `gru3` aliases.
+     * 
+     * Per neuron weights: 6 for GRU1, 4 for GRU2 and GRU3, plus 1 with `GB`,
+     * against 9 for `gru` with gate biases.
+     * 
+     * @tparam S    Size
+     * @tparam V    Gate inputs
+     * @tparam TA   Activation function ID
+     * @tparam TRA  Activation function ID for reset gate
+     * @tparam TUA  Activation function ID for update gate
+     * @tparam GB   Add a bias weight to the candidate state?
+     * @tparam B    Add 1 bias neuron with fixed value `1` to the layer?
+     * @tparam C    Clear the accumulator (input) on every forward pass?
+     */
+    template <size_t S,
+              gru_variant_e V,
+              activation_e TA = TANH,
+              activation_e TRA = FAST_SIGMOID,
+              activation_e TUA = FAST_SIGMOID,
+              bool GB = false,
+              bool B = true,
+              bool C = true>
+    struct reduced_gru : public base_cluster<S, B, ((V == GRU1 ? 2 : 1) * 2 + (GB ? 3 : 2)) * S, 0, true> {
+        using base =            base_cluster<S, B, ((V == GRU1 ? 2 : 1) * 2 + (GB ? 3 : 2)) * S, 0, true>;
+        constexpr operator base&() noexcept { return *static_cast<base *const>(this); }
+        constexpr operator const base&() const noexcept { return *static_cast<const base *const>(this); }
+
+        /// Weights per gate, and per neuron: reset gate, update gate, candidate
+        static constexpr const size_t gate_weights { V == GRU1 ? 2 : 1 };
+        static constexpr const size_t stride { gate_weights * 2 + (GB ? 3 : 2) };
+
+        /**
+         * @brief Gate pre-activation, `w` points at the gate's weights,
+         * `M` apart.
+         */
+        template <size_t M = 1>
+        static constexpr auto gate(const weight_t *const w, const state_t s) noexcept {
+            if constexpr (V == GRU1) {
+                return w[0] * s + w[M];
+            } else if constexpr (V == GRU2) {
+                return w[0] * s;
+            } else {
+                return w[0];
+            }
+        }
+
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            activate(a, s, w, ignore_state {});
+        }
+
+        template <typename F>
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w, F&& visit) noexcept {
+            for (size_t i = 0; i < S; ++i) {
+                const auto *_w = w + i * stride;
+                const auto reset_gate  = activation<TRA>::run(gate(_w, s[i]));
+                const auto update_gate = activation<TUA>::run(gate(_w + gate_weights, s[i]));
+                const auto *_c = _w + 2 * gate_weights;
+                if constexpr (!GB) {
+                    const auto new_state = activation<TA>::run(_c[0] * a[i] + _c[1] * (reset_gate * s[i]));
+                    s[i] = (1 - update_gate) * s[i] + update_gate * new_state;
+                } else {
+                    const auto new_state = activation<TA>::run(_c[0] * a[i] + _c[1] * (reset_gate * s[i]) + _c[2]);
+                    s[i] = (1 - update_gate) * s[i] + update_gate * new_state;
+                }
+                visit(s[i]);
+            }
+            if constexpr (C) {
+                for (size_t i = 0; i < S; ++i) {
+                    a[i] = 0;
+                }
+            }
+        }
+
+        template <size_t M>
+        static constexpr void activate_lanes(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            for (size_t i = 0; i < S; ++i) {
+                const auto *const _w = w + i * stride * M;
+                const auto *const _c = _w + 2 * gate_weights * M;
+                auto *const _a = a + i * M;
+                auto *const _s = s + i * M;
+                for (size_t m = 0; m < M; ++m) {
+                    const auto reset_gate  = activation<TRA>::run(gate<M>(_w + m, _s[m]));
+                    const auto update_gate = activation<TUA>::run(gate<M>(_w + gate_weights * M + m, _s[m]));
+                    if constexpr (!GB) {
+                        const auto new_state = activation<TA>::run(_c[m] * _a[m] + _c[M + m] * (reset_gate * _s[m]));
+                        _s[m] = (1 - update_gate) * _s[m] + update_gate * new_state;
+                    } else {
+                        const auto new_state = activation<TA>::run(_c[m] * _a[m] + _c[M + m] * (reset_gate * _s[m]) + _c[2 * M + m]);
+                        _s[m] = (1 - update_gate) * _s[m] + update_gate * new_state;
+                    }
+                }
+            }
+            if constexpr (C) {
+                for (size_t i = 0; i < S * M; ++i) {
+                    a[i] = 0;
+                }
+            }
+        }
+    };
+
+    template <size_t S, activation_e TA = TANH, activation_e TRA = FAST_SIGMOID, activation_e TUA = FAST_SIGMOID,
+              bool GB = false, bool B = true, bool C = true>
+    using gru1 = reduced_gru<S, GRU1, TA, TRA, TUA, GB, B, C>;
+
+    template <size_t S, activation_e TA = TANH, activation_e TRA = FAST_SIGMOID, activation_e TUA = FAST_SIGMOID,
+              bool GB = false, bool B = true, bool C = true>
+    using gru2 = reduced_gru<S, GRU2, TA, TRA, TUA, GB, B, C>;
+
+    template <size_t S, activation_e TA = TANH, activation_e TRA = FAST_SIGMOID, activation_e TUA = FAST_SIGMOID,
+              bool GB = false, bool B = true, bool C = true>
+    using gru3 = reduced_gru<S, GRU3, TA, TRA, TUA, GB, B, C>;
+
+    /**
+     * @brief Recurrent neuron cluster, minimal gated unit: one forget gate
+     * doing the work of the GRU's reset and update gates.
+     * https://arxiv.org/pdf/1603.09420.pdf
+     * 
+     * 4 weights (6 with biases) and 2 activations per neuron.
+     * 
+     * @tparam S    Size
+     * @tparam TA   Activation function ID
+     * @tparam TFA  Activation function ID for the forget gate
+     * @tparam GB   Add bias weights to the gate and the candidate state?
+     * @tparam B    Add 1 bias neuron with fixed value `1` to the layer?
+     * @tparam C    Clear the accumulator (input) on every forward pass?
+     */
+    template <size_t S,
+              activation_e TA = TANH,
+              activation_e TFA = FAST_SIGMOID,
+              bool GB = false,
+              bool B = true,
+              bool C = true>
+    struct mgu : public base_cluster<S, B, (GB ? 6 : 4) * S, 0, true> {
+        using base =    base_cluster<S, B, (GB ? 6 : 4) * S, 0, true>;
+        constexpr operator base&() noexcept { return *static_cast<base *const>(this); }
+        constexpr operator const base&() const noexcept { return *static_cast<const base *const>(this); }
+
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            activate(a, s, w, ignore_state {});
+        }
+
+        template <typename F>
+        static constexpr void activate(accumulator_t *const a, state_t *const s, const weight_t *const w, F&& visit) noexcept {
+            auto *_w = w;
+            for (size_t i = 0; i < S; ++i) {
+                if constexpr (!GB) {
+                    const auto forget_gate = activation<TFA>::run(_w[0] * a[i] + _w[1] * s[i]);
+                    const auto new_state   = activation<TA >::run(_w[2] * a[i] + _w[3] * (forget_gate * s[i]));
+                    _w += 4;
+                    s[i] = (1 - forget_gate) * s[i] + forget_gate * new_state;
+                } else {
+                    const auto forget_gate = activation<TFA>::run(_w[0] * a[i] + _w[1] * s[i] + _w[2]);
+                    const auto new_state   = activation<TA >::run(_w[3] * a[i] + _w[4] * (forget_gate * s[i]) + _w[5]);
+                    _w += 6;
+                    s[i] = (1 - forget_gate) * s[i] + forget_gate * new_state;
+                }
+                visit(s[i]);
+            }
+            if constexpr (C) {
+                for (size_t i = 0; i < S; ++i) {
+                    a[i] = 0;
+                }
+            }
+        }
+
+        template <size_t M>
+        static constexpr void activate_lanes(accumulator_t *const a, state_t *const s, const weight_t *const w) noexcept {
+            constexpr const size_t stride { GB ? 6 : 4 };
+            for (size_t i = 0; i < S; ++i) {
+                const auto *const _w = w + i * stride * M;
+                auto *const _a = a + i * M;
+                auto *const _s = s + i * M;
+                for (size_t m = 0; m < M; ++m) {
+                    if constexpr (!GB) {
+                        const auto forget_gate = activation<TFA>::run(_w[0 * M + m] * _a[m] + _w[1 * M + m] * _s[m]);
+                        const auto new_state   = activation<TA >::run(_w[2 * M + m] * _a[m] + _w[3 * M + m] * (forget_gate * _s[m]));
+                        _s[m] = (1 - forget_gate) * _s[m] + forget_gate * new_state;
+                    } else {
+                        const auto forget_gate = activation<TFA>::run(_w[0 * M + m] * _a[m] + _w[1 * M + m] * _s[m] + _w[2 * M + m]);
+                        const auto new_state   = activation<TA >::run(_w[3 * M + m] * _a[m] + _w[4 * M + m] * (forget_gate * _s[m]) + _w[5 * M + m]);
+                        _s[m] = (1 - forget_gate) * _s[m] + forget_gate * new_state;
+                    }
+                }
+            }
+            if constexpr (C) {
+                for (size_t i = 0; i < S * M; ++i) {
+                    a[i] = 0;
+                }
+            }
+        }
+    };
 }
\ No newline at end of file
@@ -0,0 +1,478 @@
+/**
+ * @brief Parameter server for training with several processes on one host
+ *
+ * @file parameter_server.hpp
+ *
+ * A `parameter_server` owns the authoritative weights of one network. Worker
+ * processes pull a copy, compute an update against it (on a simulation, a
+ * historical replay, ...) and push it back. Updates are applied as they
+ * arrive, without a barrier between workers.
+ *
+ * Every applied update bumps the weight version. A push carries the version
+ * its update was computed against, and the server rejects it if more than
+ * `max_staleness` updates were applied since. The worker then pulls again
+ * and recomputes. So no applied update is ever older than the bound.
+ *
+ * Transports are the same as in serving.hpp:
+ *
+ * - A Unix domain socket (`SOCK_SEQPACKET`), one message per pull or push.
+ *   Messages carry the whole weight buffer, so it has to fit the socket
+ *   buffer (`net.core.wmem_max`). Both sides size their send buffers for
+ *   their largest message. A client whose response can't be sent is
+ *   disconnected and counted, so it fails instead of waiting forever.
+ * - A shared memory segment. Workers read the weights straight from the
+ *   segment under a sequence lock and hand updates over in per worker slots.
+ *   Slots of workers that died are reclaimed by the next worker to attach.
+ */
+
+#pragma once
+
+#include "forward_declarations.hpp"
+#include "serving.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+
+
+namespace neural_network_tools {
+    enum parameter_op_e : uint32_t {
+        PULL,       ///< Fetch the current weights and version
+        PUSH        ///< Apply an update computed against `base_version`
+    };
+
+    template <typename N>
+    struct parameter_request {
+        static constexpr const size_t header_size { 16 };
+
+        uint32_t op { PULL };
+        uint32_t reserved { 0 };
+        uint64_t base_version { 0 };
+        std::array<weight_t, N::weights_size> gradient {};  ///< Only sent with `PUSH`
+    };
+
+    template <typename N>
+    struct parameter_response {
+        static constexpr const size_t header_size { 16 };
+
+        uint64_t version { 0 };                             ///< Version after the request
+        uint32_t accepted { 0 };                            ///< Push applied, always 1 for a pull
+        uint32_t staleness { 0 };                           ///< Updates applied since the pushed base version
+        std::array<weight_t, N::weights_size> weights {};   ///< Only sent for `PULL`
+    };
+
+    /**
+     * @brief Layout of the shared memory segment.
+     *
+     * @tparam N    Network type
+     * @tparam W    Worker slot count
+     */
+    template <typename N, size_t W = 16>
+    struct parameter_segment {
+        static constexpr const uint64_t magic_value { 0x6e6e742d70737632 }; // "nnt-psv2"
+        static constexpr const size_t slots_size { W };
+
+        static_assert(std::atomic<weight_t>::is_always_lock_free, "Shared weights need lock free atomics");
+
+        static constexpr detail::segment_header identity() noexcept {
+            return { magic_value, sizeof(parameter_segment), detail::layout_fingerprint<N>({ W }) };
+        }
+
+        enum slot_state_e : uint32_t {
+            IDLE,
+            PUSHED,     ///< Update written by the worker, waiting for the server
+            DONE        ///< Result written by the server, waiting for the worker
+        };
+
+        struct alignas(cache_line_size) slot {
+            std::atomic<uint32_t> state { IDLE };
+            uint32_t accepted { 0 };
+            uint32_t staleness { 0 };
+            uint64_t base_version { 0 };
+            uint64_t version { 0 };
+            alignas(cache_line_size) std::array<weight_t, N::weights_size> gradient {};
+        };
+
+        detail::segment_header header { identity() };
+        std::atomic<uint32_t> claims { 0 };
+        std::array<std::atomic<uint64_t>, W> claimed {};    ///< Claim token of the owner, 0 when free
+        std::array<std::atomic<uint64_t>, W> opened {};     ///< Claim token the server reset the slot for
+
+        /**
+         * Sequence lock over `version` and `weights`, odd while the server
+         * writes. Both sides copy with relaxed atomic accesses, so a copy that
+         * overlaps a write is torn and retried, but never a data race.
+         */
+        alignas(cache_line_size) std::atomic<uint64_t> sequence { 0 };
+        std::atomic<uint64_t> version { 0 };
+        alignas(cache_line_size) std::array<std::atomic<weight_t>, N::weights_size> weights {};
+
+        std::array<slot, W> slots;
+    };
+
+    /**
+     * @brief Owns the authoritative weights of a network and applies the
+     * updates workers push, plain SGD: `weights -= learning_rate * gradient`.
+     *
+     * Single threaded: call `poll()` in a loop or hand a thread to `run()`.
+     * Change `net.weights` only through the server while it lives, workers
+     * would not see the change. The server owns the socket file and shared
+     * memory name while it lives.
+     *
+     * Updates have the layout of `weights`, padding included. Keep the
+     * padding entries zero, the kernels rely on zero weights there.
+     *
+     * @tparam N    Network type
+     * @tparam W    Shared memory worker slots
+     */
+    template <typename N, size_t W = 16>
+    class parameter_server {
+    public:
+        using request_t = parameter_request<N>;
+        using response_t = parameter_response<N>;
+        using segment_t = parameter_segment<N, W>;
+
+    private:
+        N& net;
+        std::string socket_path;
+        std::string shm_name;
+        int listen_fd { -1 };
+        std::vector<int> clients;
+        segment_t *shm { nullptr };
+        uint64_t current { 0 };
+        bool published { true };
+
+        request_t request;
+        response_t response;
+
+        static_assert(offsetof(request_t, gradient) == request_t::header_size && offsetof(response_t, weights) == response_t::header_size);
+
+        void accept_clients() {
+            for (;;) {
+                const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) return;
+                detail::reserve_send_buffer(fd, sizeof(response_t));
+                clients.push_back(fd);
+            }
+        }
+
+        /// Apply `gradient` if it is fresh enough, fills in the result fields of `r`.
+        template <typename R>
+        void apply(const uint64_t base_version, const weight_t *const gradient, R& r) noexcept {
+            r.staleness = static_cast<uint32_t>(std::min<uint64_t>(current - std::min(base_version, current), UINT32_MAX));
+            r.accepted = base_version <= current && r.staleness <= max_staleness;
+            if (r.accepted) {
+                for (size_t i = 0; i < N::weights_size; ++i) {
+                    net.weights[i] -= learning_rate * gradient[i];
+                }
+                ++current;
+                ++applied;
+                total_staleness += r.staleness;
+                published = false;
+            } else {
+                ++rejected;
+            }
+            r.version = current;
+        }
+
+        void publish() noexcept {
+            if (published) return;
+            published = true;
+            if (!shm) return;
+            const auto s = shm->sequence.load(std::memory_order_relaxed);
+            shm->sequence.store(s + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            shm->version.store(current, std::memory_order_relaxed);
+            for (size_t i = 0; i < N::weights_size; ++i) {
+                shm->weights[i].store(net.weights[i], std::memory_order_relaxed);
+            }
+            shm->sequence.store(s + 2, std::memory_order_release);
+        }
+
+        size_t poll_shared() {
+            std::array<bool, W> handled {};
+            size_t n = 0;
+            for (size_t w = 0; w < W; ++w) {
+                auto& s = shm->slots[w];
+                const auto owner = shm->claimed[w].load(std::memory_order_acquire);
+                if (owner != shm->opened[w].load(std::memory_order_relaxed)) {
+                    // New owner or none: drop whatever the previous one left behind
+                    s.state.store(segment_t::IDLE, std::memory_order_relaxed);
+                    shm->opened[w].store(owner, std::memory_order_release);
+                }
+                if (!owner || s.state.load(std::memory_order_acquire) != segment_t::PUSHED) continue;
+                apply(s.base_version, s.gradient.data(), s);
+                handled[w] = true;
+                ++n;
+            }
+            if (!n) return 0;
+            // Publish first, so a worker that sees its result can pull the version it was told
+            publish();
+            for (size_t w = 0; w < W; ++w) {
+                if (handled[w]) shm->slots[w].state.store(segment_t::DONE, std::memory_order_release);
+            }
+            return n;
+        }
+
+        size_t poll_socket() {
+            size_t n = 0;
+            for (size_t i = 0; i < clients.size(); ++i) {
+                for (;;) {
+                    const auto r = recv(clients[i], &request, sizeof(request_t), MSG_DONTWAIT);
+                    if (r < static_cast<ssize_t>(request_t::header_size)) {
+                        if (r >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                            close(clients[i]); // Client went away
+                            clients.erase(clients.begin() + i--);
+                        }
+                        break;
+                    }
+                    size_t size = response_t::header_size;
+                    if (request.op == PUSH && r == static_cast<ssize_t>(sizeof(request_t))) {
+                        apply(request.base_version, request.gradient.data(), response);
+                    } else {
+                        response.version = current;
+                        response.accepted = request.op == PULL;
+                        response.staleness = 0;
+                        if (request.op == PULL) {
+                            for (size_t j = 0; j < N::weights_size; ++j) {
+                                response.weights[j] = net.weights[j];
+                            }
+                            size = sizeof(response_t);
+                        }
+                    }
+                    if (send(clients[i], &response, size, MSG_NOSIGNAL) != static_cast<ssize_t>(size)) {
+                        // Never wait for a client, but don't leave it waiting for an answer that won't come
+                        ++disconnected;
+                        close(clients[i]);
+                        clients.erase(clients.begin() + i--);
+                        break;
+                    }
+                    ++n;
+                }
+            }
+            return n;
+        }
+
+    public:
+        weight_t learning_rate;
+        uint32_t max_staleness;
+
+        size_t applied { 0 };
+        size_t rejected { 0 };
+        size_t total_staleness { 0 };   ///< Sum over applied updates, for the mean
+        size_t disconnected { 0 };      ///< Socket clients closed because their response couldn't be sent
+
+        /**
+         * @param n             Network owning the weights, must outlive the server
+         * @param socket        Unix socket path, empty to disable
+         * @param shm_segment   Shared memory name (eg `/trainer`), empty to disable
+         * @param rate          Learning rate
+         * @param staleness     Maximum updates applied between a pull and the push based on it
+         */
+        parameter_server(N& n, const std::string& socket, const std::string& shm_segment = {},
+                         const weight_t rate = 0.01, const uint32_t staleness = 8)
+            : net { n }, socket_path { socket }, shm_name { shm_segment }, learning_rate { rate }, max_staleness { staleness } {
+            if (!socket_path.empty()) {
+                listen_fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+                if (listen_fd < 0) detail::throw_errno("socket");
+                unlink(socket_path.c_str());
+                const auto addr = detail::unix_address(socket_path);
+                if (bind(listen_fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) < 0) detail::throw_errno("bind");
+                if (listen(listen_fd, 64) < 0) detail::throw_errno("listen");
+            }
+            if (!shm_name.empty()) {
+                shm = new (detail::map_shared<segment_t>(shm_name, true)) segment_t {};
+                published = false;
+                publish();
+            }
+        }
+
+        parameter_server(const parameter_server&) = delete;
+        parameter_server& operator=(const parameter_server&) = delete;
+
+        ~parameter_server() {
+            for (const auto fd : clients) close(fd);
+            if (listen_fd >= 0) {
+                close(listen_fd);
+                unlink(socket_path.c_str());
+            }
+            if (shm) {
+                munmap(shm, sizeof(segment_t));
+                shm_unlink(shm_name.c_str());
+            }
+        }
+
+        /// Number of updates applied so far.
+        uint64_t version() const noexcept {
+            return current;
+        }
+
+        /**
+         * @brief Handle whatever pulls and pushes are waiting.
+         *
+         * @return Number of requests handled
+         */
+        size_t poll() {
+            if (listen_fd >= 0) accept_clients();
+            size_t n = shm ? poll_shared() : 0;
+            n += poll_socket();
+            publish();
+            return n;
+        }
+
+        /**
+         * @brief Serve until `stop` is set, yielding the core while idle.
+         */
+        void run(const std::atomic<bool>& stop) {
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (!poll()) detail::relax();
+            }
+        }
+    };
+
+    /**
+     * @brief Worker side of a `parameter_server`.
+     *
+     * Not thread safe, use one client per thread.
+     */
+    template <typename N, size_t W = 16>
+    class parameter_client {
+    public:
+        using request_t = parameter_request<N>;
+        using response_t = parameter_response<N>;
+        using segment_t = parameter_segment<N, W>;
+
+        struct push_result {
+            bool accepted;
+            uint64_t version;       ///< Server version after the push
+            uint32_t staleness;
+        };
+
+    private:
+        int fd { -1 };
+        segment_t *shm { nullptr };
+        size_t slot { 0 };
+        uint64_t token { 0 };
+        request_t request;
+        response_t response;
+
+    public:
+        /**
+         * @param transport Transport to use
+         * @param address   Socket path or shared memory name
+         * @param timeout   Shared memory: how long to wait for the server to
+         *                  open the claimed slot
+         */
+        parameter_client(const serving_transport_e transport, const std::string& address,
+                         const std::chrono::milliseconds timeout = std::chrono::seconds { 1 }) {
+            if (transport == UNIX_SOCKET) {
+                fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+                if (fd < 0) detail::throw_errno("socket");
+                const auto addr = detail::unix_address(address);
+                detail::reserve_send_buffer(fd, sizeof(request_t));
+                if (connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) < 0) {
+                    close(fd);
+                    detail::throw_errno("connect");
+                }
+            } else {
+                shm = detail::attach_shared<segment_t>(address);
+                slot = detail::claim_slot(shm->claimed, shm->claims, token);
+                if (slot == segment_t::slots_size) {
+                    munmap(shm, sizeof(segment_t));
+                    throw std::runtime_error("No free shared memory slot");
+                }
+                // The slot is ours once the server reset it for this claim
+                const auto deadline = std::chrono::steady_clock::now() + timeout;
+                while (shm->opened[slot].load(std::memory_order_acquire) != token) {
+                    if (std::chrono::steady_clock::now() > deadline) {
+                        shm->claimed[slot].store(0, std::memory_order_release);
+                        munmap(shm, sizeof(segment_t));
+                        throw std::runtime_error("Parameter server didn't open the shared memory slot");
+                    }
+                    detail::relax();
+                }
+            }
+        }
+
+        parameter_client(const parameter_client&) = delete;
+        parameter_client& operator=(const parameter_client&) = delete;
+
+        ~parameter_client() {
+            if (fd >= 0) close(fd);
+            if (shm) {
+                shm->claimed[slot].store(0, std::memory_order_release);
+                munmap(shm, sizeof(segment_t));
+            }
+        }
+
+        /**
+         * @brief Copy the current weights to `weights`.
+         *
+         * @return Version of the copy, the base version for the next push
+         */
+        uint64_t pull(weight_t *const weights) {
+            if (shm) {
+                for (;;) {
+                    const auto s = shm->sequence.load(std::memory_order_acquire);
+                    if (s & 1) {
+                        detail::relax();
+                        continue;
+                    }
+                    const auto version = shm->version.load(std::memory_order_relaxed);
+                    for (size_t i = 0; i < N::weights_size; ++i) {
+                        weights[i] = shm->weights[i].load(std::memory_order_relaxed);
+                    }
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (shm->sequence.load(std::memory_order_relaxed) == s) return version;
+                }
+            }
+            request.op = PULL;
+            if (::send(fd, &request, request_t::header_size, MSG_NOSIGNAL) != static_cast<ssize_t>(request_t::header_size)) {
+                detail::throw_errno("send");
+            }
+            if (recv(fd, &response, sizeof(response_t), 0) != static_cast<ssize_t>(sizeof(response_t))) {
+                detail::throw_errno("recv");
+            }
+            std::copy(response.weights.begin(), response.weights.end(), weights);
+            return response.version;
+        }
+
+        uint64_t pull(N& net) {
+            return pull(net.weights.data());
+        }
+
+        /**
+         * @brief Push an update and wait until the server applied or rejected
+         * it. After a rejection pull again before computing the next update.
+         *
+         * @param gradient      `N::weights_size` values, subtracted from the
+         *                      weights after scaling with the learning rate
+         * @param base_version  Version returned by the pull the update is based on
+         */
+        push_result push(const weight_t *const gradient, const uint64_t base_version) {
+            if (shm) {
+                auto& s = shm->slots[slot];
+                std::copy(gradient, gradient + N::weights_size, s.gradient.begin());
+                s.base_version = base_version;
+                s.state.store(segment_t::PUSHED, std::memory_order_release);
+                while (s.state.load(std::memory_order_acquire) != segment_t::DONE) detail::relax();
+                const push_result r { s.accepted != 0, s.version, s.staleness };
+                s.state.store(segment_t::IDLE, std::memory_order_relaxed);
+                return r;
+            }
+            request.op = PUSH;
+            request.base_version = base_version;
+            std::copy(gradient, gradient + N::weights_size, request.gradient.begin());
+            if (::send(fd, &request, sizeof(request_t), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(request_t))) {
+                detail::throw_errno("send");
+            }
+            if (recv(fd, &response, response_t::header_size, 0) != static_cast<ssize_t>(response_t::header_size)) {
+                detail::throw_errno("recv");
+            }
+            return { response.accepted != 0, response.version, response.staleness };
+        }
+    };
+}
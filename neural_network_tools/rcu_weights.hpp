@@ -0,0 +1,141 @@
+/**
+ * @brief Weight sets shared between a training thread and inference threads
+ *
+ * @file rcu_weights.hpp
+ *
+ * Read-copy-update: the trainer works on a private copy of the weights and
+ * publishes it with an atomic pointer swap. Readers pin the current set
+ * for the duration of a prediction and never block or retry. The trainer
+ * reuses a retired set only after every reader that could still see it has
+ * moved on (epoch based reclamation), so it is the only side that ever waits.
+ */
+
+#pragma once
+
+#include "forward_declarations.hpp"
+#include "storage.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+
+namespace neural_network_tools {
+    /**
+     * @brief Double buffered, RCU published weights for network type `N`.
+     *
+     * @tparam N    Network type
+     * @tparam R    Maximum number of concurrent reader threads
+     */
+    template <typename N, size_t R = 16>
+    class rcu_weights {
+    public:
+        struct weight_set {
+            alignas(cache_line_size) std::array<weight_t, N::weights_size> weights {};
+            uint64_t version { 0 };
+        };
+
+    private:
+        static constexpr const uint64_t idle { 0 };
+
+        struct alignas(cache_line_size) reader_slot {
+            std::atomic<uint64_t> epoch { idle };
+            std::atomic<bool> claimed { false };
+        };
+
+        std::array<weight_set, 2> sets {};
+        std::atomic<weight_set *> current { &sets[0] };
+        alignas(cache_line_size) std::atomic<uint64_t> epoch { 1 };
+        std::array<reader_slot, R> readers {};
+
+        /// Wait until no reader can still hold a set published before `e`.
+        void synchronise(const uint64_t e) const noexcept {
+            for (const auto& r : readers) {
+                for (;;) {
+                    const auto re = r.epoch.load(std::memory_order_seq_cst);
+                    if (re == idle || re >= e) break;
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+    public:
+        /**
+         * @brief Per thread read handle, pins a weight set while a prediction runs.
+         */
+        class reader {
+        private:
+            rcu_weights *rcu { nullptr };
+            reader_slot *slot { nullptr };
+
+        public:
+            explicit reader(rcu_weights& r) : rcu { &r } {
+                for (auto& s : r.readers) {
+                    bool expected = false;
+                    if (s.claimed.compare_exchange_strong(expected, true)) {
+                        slot = &s;
+                        return;
+                    }
+                }
+                throw std::runtime_error("No free RCU reader slot");
+            }
+
+            reader(const reader&) = delete;
+            reader& operator=(const reader&) = delete;
+
+            ~reader() {
+                slot->epoch.store(idle, std::memory_order_release);
+                slot->claimed.store(false, std::memory_order_release);
+            }
+
+            /**
+             * @brief Pin and return the current weight set. Valid until `unlock()`.
+             */
+            const weight_set& lock() noexcept {
+                slot->epoch.store(rcu->epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+                return *rcu->current.load(std::memory_order_seq_cst);
+            }
+
+            void unlock() noexcept {
+                slot->epoch.store(idle, std::memory_order_release);
+            }
+
+            /**
+             * @brief Advance `net` one step using the current published weights.
+             */
+            void activate(N& net) noexcept {
+                net.activate(lock().weights.data());
+                unlock();
+            }
+        };
+
+        explicit rcu_weights(const N& net) {
+            for (size_t i = 0; i < N::weights_size; ++i) sets[0].weights[i] = net.weights[i];
+        }
+
+        /**
+         * @brief Publish a new weight set. Trainer side, one publisher at a time.
+         *
+         * Copies the weights into the retired set and swaps it in, then waits
+         * for readers of the set it replaced so that set can be reused on the
+         * next call. Readers are never held up.
+         *
+         * @param w Weights in the buffer layout of `N`, eg `trainer.weights`
+         * @return Version of the published set
+         */
+        template <typename W>
+        uint64_t publish(const W& w) noexcept {
+            auto *const old = current.load(std::memory_order_relaxed);
+            auto *const next = old == &sets[0] ? &sets[1] : &sets[0];
+            for (size_t i = 0; i < N::weights_size; ++i) next->weights[i] = w[i];
+            next->version = old->version + 1;
+            current.store(next, std::memory_order_seq_cst);
+            synchronise(epoch.fetch_add(1, std::memory_order_seq_cst) + 1);
+            return next->version;
+        }
+
+        uint64_t version() const noexcept {
+            return current.load(std::memory_order_acquire)->version;
+        }
+    };
+}
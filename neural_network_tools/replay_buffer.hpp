@@ -0,0 +1,227 @@
+/**
+ * @brief Experience replay for training between steps
+ *
+ * @file replay_buffer.hpp
+ *
+ * Keeps the most recent steps of a network so training can draw
+ * decorrelated mini-batches instead of learning from the latest step only.
+ * A sample is the `snapshot` taken right before a step: the inputs (which
+ * carry the targets, see `steer_to_ideal`) and the hidden state. Replaying
+ * a sample restores it, activates and checks, which reproduces the error of
+ * the original step under the current weights.
+ *
+ * Storage is one preallocated ring of cache line aligned samples, recording
+ * only copies the snapshot into the oldest slot. Prioritised sampling keeps
+ * a sum tree over the sample priorities next to the ring.
+ */
+
+#pragma once
+
+#include "forward_declarations.hpp"
+#include "storage.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+
+
+namespace neural_network_tools {
+    enum replay_sampling_e {
+        UNIFORM,        ///< Every stored sample equally likely
+        PRIORITISED     ///< Proportional to `(error + epsilon)^alpha`, with importance weights
+    };
+
+    /**
+     * @brief Sample indices drawn for one mini-batch, with the importance
+     * weight to scale each sample's update by. Weights are 1 for uniform
+     * sampling.
+     */
+    template <size_t B>
+    struct replay_batch {
+        static constexpr const size_t size { B };
+
+        std::array<size_t, B> indices {};
+        std::array<error_t, B> weights {};
+    };
+
+    /**
+     * @brief Fixed capacity ring of recent steps of network type `N`.
+     *
+     * @tparam N    Network type
+     * @tparam C    Capacity in steps
+     * @tparam RS   Sampling scheme
+     */
+    template <typename N, size_t C, replay_sampling_e RS = UNIFORM>
+    class replay_buffer {
+        static_assert(C > 0, "Replay buffer needs a capacity");
+
+    public:
+        using snapshot_t = typename N::snapshot;
+
+        struct alignas(cache_line_size) sample {
+            snapshot_t snap;
+            error_t error { 0 };    ///< Error of the last `update()`
+        };
+
+        static constexpr const size_t capacity { C };
+
+    private:
+        static constexpr size_t leaves_size() noexcept {
+            size_t n = 1;
+            while (n < C) n <<= 1;
+            return n;
+        }
+
+        static constexpr const size_t leaves { RS == PRIORITISED ? leaves_size() : 0 };
+
+        std::array<sample, C> samples;
+        std::array<double, 2 * leaves> tree {};     // Sum tree, root at 1, leaf i at `leaves + i`
+        std::array<error_t, N::errors_size> live_errors {};    // Per neuron errors of the live step during a batch
+        size_t head { 0 };
+        size_t count { 0 };
+        double max_priority { 1 };
+
+        void set_priority(const size_t i, const double p) noexcept {
+            size_t n = leaves + i;
+            const double d = p - tree[n];
+            for (; n; n >>= 1) tree[n] += d;
+        }
+
+        /// Leaf whose cumulative priority range holds `u`.
+        size_t find(double u) const noexcept {
+            size_t n = 1;
+            while (n < leaves) {
+                n <<= 1;
+                if (u >= tree[n]) {
+                    u -= tree[n];
+                    ++n;
+                }
+            }
+            return std::min(n - leaves, count - 1);
+        }
+
+    public:
+        double alpha { 0.6 };       ///< Priority exponent, 0 is uniform
+        double beta { 0.4 };        ///< Importance correction exponent, 1 undoes the bias fully
+        double epsilon { 1e-3 };    ///< Keeps zero error samples drawable
+
+        size_t size() const noexcept { return count; }
+        bool empty() const noexcept { return count == 0; }
+
+        const sample& operator[](const size_t i) const noexcept { return samples[i]; }
+
+        /**
+         * @brief Store the current state of `net`, call it after setting the
+         * inputs and before `activate()`. Overwrites the oldest sample once full.
+         *
+         * New samples get the highest priority seen so far, so each is
+         * likely to be replayed at least once. Pass the index and the error
+         * of the live `check()` to `update()` to set it from the step instead.
+         *
+         * @return Index of the sample
+         */
+        size_t record(const N& net) noexcept {
+            const size_t i = head;
+            auto& s = samples[i];
+            std::copy(net.accumulators.begin(), net.accumulators.end(), s.snap.accumulators.begin());
+            std::copy(net.states.begin(), net.states.end(), s.snap.states.begin());
+            s.snap.step = net.step;
+            s.error = 0;
+            if constexpr (RS == PRIORITISED) set_priority(i, max_priority);
+
+            head = head + 1 == C ? 0 : head + 1;
+            if (count < C) ++count;
+            return i;
+        }
+
+        /**
+         * @brief Set the priority of sample `i` from a new error, eg after
+         * replaying it.
+         */
+        void update(const size_t i, const error_t e) noexcept {
+            samples[i].error = e;
+            if constexpr (RS == PRIORITISED) {
+                const double p = std::pow(std::abs(e) + epsilon, alpha);
+                max_priority = std::max(max_priority, p);
+                set_priority(i, p);
+            }
+        }
+
+        /**
+         * @brief Draw a mini-batch, with replacement. The buffer must not be empty.
+         *
+         * Prioritised draws are stratified: one draw from each of `B` equal
+         * slices of the total priority.
+         *
+         * @param g URBG, eg `std::mt19937_64`
+         */
+        template <typename G, size_t B>
+        void draw(G& g, replay_batch<B>& batch) const {
+            if constexpr (RS == UNIFORM) {
+                std::uniform_int_distribution<size_t> d { 0, count - 1 };
+                for (size_t b = 0; b < B; ++b) {
+                    batch.indices[b] = d(g);
+                    batch.weights[b] = 1;
+                }
+            } else {
+                const double total = tree[1];
+                const double slice = total / B;
+                std::uniform_real_distribution<double> d { 0, slice };
+                double max_weight = 0;
+                for (size_t b = 0; b < B; ++b) {
+                    const size_t i = find(b * slice + d(g));
+                    batch.indices[b] = i;
+                    // (count * P(i))^-beta
+                    const double w = std::pow(count * tree[leaves + i] / total, -beta);
+                    batch.weights[b] = static_cast<error_t>(w);
+                    max_weight = std::max(max_weight, w);
+                }
+                for (auto& w : batch.weights) w = static_cast<error_t>(w / max_weight);
+            }
+        }
+
+        /**
+         * @brief Replay sample `i` on `net`: restore it, activate and check.
+         *
+         * Leaves `net` in the replayed state, with its errors set for
+         * `train()`. Fork the live state before and restore it after.
+         *
+         * @return Error of the replayed step
+         */
+        error_t replay(N& net, const size_t i) const {
+            net.restore(samples[i].snap);
+            net.activate();
+            net.check();
+            return net.error;
+        }
+
+        /**
+         * @brief Replay a mini-batch between steps, then return `net` to its
+         * live state, per neuron errors included. Calls `f(net, index, weight)` after each replayed step,
+         * and updates the sample's priority from the replayed error.
+         *
+         * Replayed steps are older than the live one, so `last_learned` is
+         * cleared for `f`: a `train()` call there learns from the replayed step.
+         */
+        template <size_t B, typename F>
+        void replay(N& net, const replay_batch<B>& batch, F&& f) {
+            const auto live = net.fork();
+            std::copy(net.errors.begin(), net.errors.end(), live_errors.begin());
+            const auto live_error = net.error;
+            const auto live_checked = net.last_checked;
+            const auto live_learned = net.last_learned;
+            for (size_t b = 0; b < B; ++b) {
+                const auto i = batch.indices[b];
+                update(i, replay(net, i));
+                net.last_learned = 0;
+                f(net, i, batch.weights[b]);
+            }
+            net.restore(live);
+            std::copy(live_errors.begin(), live_errors.end(), net.errors.begin());
+            net.error = live_error;
+            net.last_checked = live_checked;
+            net.last_learned = live_learned;
+        }
+    };
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "forward_declarations.hpp"
+#include "storage.hpp"
+
+#include <atomic>
+#include <type_traits>
+
+namespace neural_network_tools {
+    /**
+     * @brief Lock-free single producer, single consumer ring buffer.
+     *
+     * Fixed capacity and no allocation. Holds only trivially copyable
+     * elements and lock-free atomics, so it can be placed in memory shared
+     * between processes as well.
+     *
+     * @tparam T Element type
+     * @tparam D Capacity, a power of two
+     */
+    template <typename T, size_t D>
+    struct spsc_ring {
+        static_assert(D && !(D & (D - 1)), "Ring capacity must be a power of two");
+        static_assert(std::is_trivially_copyable_v<T>, "Ring elements must be trivially copyable");
+        static_assert(std::atomic<uint64_t>::is_always_lock_free, "Ring needs lock-free 64 bit atomics");
+
+        static constexpr const size_t capacity { D };
+
+        // Producer and consumer each own a cache line, with a private copy of
+        // the other side's index to avoid bouncing the shared line on every call.
+        alignas(cache_line_size) std::atomic<uint64_t> head { 0 };
+        uint64_t tail_cache { 0 };
+        alignas(cache_line_size) std::atomic<uint64_t> tail { 0 };
+        uint64_t head_cache { 0 };
+        alignas(cache_line_size) std::array<T, D> slots;
+
+        /**
+         * @brief Write the next element in place. Producer side only.
+         *
+         * @param f Called as `f(T&)` to fill the slot
+         * @return false if the ring is full, nothing is written then
+         */
+        template <typename F>
+        bool emplace(F&& f) noexcept {
+            const auto h = head.load(std::memory_order_relaxed);
+            if (unlikely(h - tail_cache == D)) {
+                tail_cache = tail.load(std::memory_order_acquire);
+                if (h - tail_cache == D) return false;
+            }
+            f(slots[h & (D - 1)]);
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool push(const T& v) noexcept {
+            return emplace([&](T& slot) { slot = v; });
+        }
+
+        /**
+         * @brief Take the oldest element. Consumer side only.
+         *
+         * @return false if the ring is empty
+         */
+        bool pop(T& v) noexcept {
+            const auto t = tail.load(std::memory_order_relaxed);
+            if (t == head_cache) {
+                head_cache = head.load(std::memory_order_acquire);
+                if (t == head_cache) return false;
+            }
+            v = slots[t & (D - 1)];
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Drop all elements. Only while neither side uses the ring.
+         */
+        void reset() noexcept {
+            head.store(0, std::memory_order_relaxed);
+            tail.store(0, std::memory_order_relaxed);
+            tail_cache = 0;
+            head_cache = 0;
+        }
+
+        size_t size() const noexcept {
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+        }
+
+        bool empty() const noexcept { return size() == 0; }
+    };
+}
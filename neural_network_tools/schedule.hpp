@@ -0,0 +1,165 @@
+/**
+ * @brief Adaptive check and learn scheduling
+ *
+ * @file schedule.hpp
+ *
+ * Calling `check()` and `train()` after every `activate()` keeps computing
+ * errors and learning long after the error has settled. A `check_schedule`
+ * replaces both calls and decides per step whether to check, and after a
+ * check whether to learn, from the error history:
+ *
+ * - `FIXED_STRIDE`     Check every `stride` steps.
+ * - `PLATEAU_BACKOFF`  Double the stride while errors stay within the noise
+ *                      band of their running mean, halve it when they leave.
+ * - `SPIKE_TRIGGER`    Back off like `PLATEAU_BACKOFF`, but watch the inputs
+ *                      every step: a jump in the inputs or an error spike
+ *                      checks and learns at once and resets the stride.
+ *
+ * The schedule only learns right after its own checks, through `learn()`, so
+ * no catch-up check runs that the schedule didn't ask for.
+ *
+ * Learning is a no-op for now: `network::learn()` is the entry point for the
+ * optimiser, which hasn't been ported yet. Until it lands the weights never
+ * change, and `learn_stride` and `learns` only pace and count the calls.
+ */
+
+#pragma once
+
+#include "forward_declarations.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+
+namespace neural_network_tools {
+    enum schedule_policy_e {
+        FIXED_STRIDE,
+        PLATEAU_BACKOFF,
+        SPIKE_TRIGGER
+    };
+
+    struct schedule_settings {
+        size_t stride { 1 };            ///< Initial (and for `FIXED_STRIDE` the only) steps between checks
+        size_t min_stride { 1 };
+        size_t max_stride { 256 };
+        size_t learn_stride { 1 };      ///< Learn after every this many checks, and after every spike
+        double backoff { 2 };           ///< Stride factor per plateau check
+        double band { 2 };              ///< Plateau: error within this many standard deviations of its mean
+        double spike { 4 };             ///< Spike: this many standard deviations above the mean
+        double alpha { 0.05 };          ///< Weight of the newest sample in the running means
+        size_t warmup { 16 };           ///< Samples before the statistics are trusted
+    };
+
+    struct schedule_action {
+        bool checked;
+        bool learned;
+    };
+
+    /**
+     * @brief Decides when network type `N` checks and learns.
+     *
+     * Call `run(net)` once per step after setting the inputs, in place of
+     * `check()` and `train()`.
+     *
+     * @tparam N    Network type
+     * @tparam P    Policy
+     */
+    template <typename N, schedule_policy_e P = SPIKE_TRIGGER>
+    class check_schedule {
+    private:
+        /// Exponentially weighted mean and variance.
+        struct running {
+            double mean { 0 };
+            double variance { 0 };
+            size_t samples { 0 };
+
+            double deviations(const double x) const noexcept {
+                return (x - mean) / std::sqrt(variance + 1e-30);
+            }
+
+            void add(const double x, const double alpha) noexcept {
+                if (!samples++) {
+                    mean = x;
+                    return;
+                }
+                const double d = x - mean;
+                mean += alpha * d;
+                variance = (1 - alpha) * (variance + alpha * d * d);
+            }
+        };
+
+        schedule_settings settings;
+        size_t stride_;
+        size_t since_learned { 0 };
+        running errors;
+        running input_moves;
+        std::array<accumulator_t, N::inputs_size> last_inputs {};
+
+        /// Has any input jumped far further than inputs usually move per step?
+        bool input_spike(const N& net) noexcept {
+            double move = 0;
+            for (size_t i = 0; i < N::inputs_size; ++i) {
+                move += std::abs(net.inputs[i] - last_inputs[i]);
+                last_inputs[i] = net.inputs[i];
+            }
+            if (!steps) return false; // Nothing to compare the first inputs with
+            const bool spike = input_moves.samples >= settings.warmup && input_moves.deviations(move) > settings.spike;
+            input_moves.add(move, settings.alpha);
+            return spike;
+        }
+
+        /// Adapt the stride to error `e` of a check, true on a spike.
+        bool observe(const double e) noexcept {
+            const bool warm = errors.samples >= settings.warmup;
+            const double z = warm ? errors.deviations(e) : 0;
+            errors.add(e, settings.alpha);
+            if constexpr (P == FIXED_STRIDE) return false;
+
+            if (P == SPIKE_TRIGGER && z > settings.spike) return true;
+            if (!warm) return false;
+            const double s = std::abs(z) <= settings.band ? stride_ * settings.backoff : stride_ / settings.backoff;
+            stride_ = std::clamp(static_cast<size_t>(s), settings.min_stride, settings.max_stride);
+            return false;
+        }
+
+    public:
+        size_t steps { 0 };
+        size_t checks { 0 };
+        size_t learns { 0 };
+        size_t spikes { 0 };
+
+        explicit check_schedule(const schedule_settings& s = {}) noexcept
+            : settings { s }, stride_ { std::clamp(s.stride, std::max<size_t>(1, s.min_stride), std::max(s.min_stride, s.max_stride)) } {
+            settings.min_stride = std::max<size_t>(1, settings.min_stride);
+            settings.max_stride = std::max(settings.min_stride, settings.max_stride);
+        }
+
+        /// Steps between checks at the moment.
+        size_t stride() const noexcept { return stride_; }
+
+        /**
+         * @brief Check and learn if the schedule says so.
+         */
+        schedule_action run(N& net) {
+            bool spike = false;
+            if constexpr (P == SPIKE_TRIGGER) spike = input_spike(net);
+            ++steps;
+            if (!spike && net.step < net.last_checked + stride_) return { false, false };
+
+            net.check();
+            ++checks;
+            spike |= observe(net.error);
+            if (spike) {
+                stride_ = settings.min_stride;
+                ++spikes;
+            }
+
+            if (!spike && ++since_learned < settings.learn_stride) return { true, false };
+            net.learn();
+            ++learns;
+            since_learned = 0;
+            return { true, true };
+        }
+    };
+}
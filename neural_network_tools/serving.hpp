@@ -0,0 +1,572 @@
+/**
+ * @brief Low latency local prediction serving
+ *
+ * @file serving.hpp
+ *
+ * A `prediction_server` keeps a network hot and answers requests from other
+ * processes on the same host. Two transports are served side by side:
+ *
+ * - A Unix domain socket (`SOCK_SEQPACKET`), one message per request.
+ * - A shared memory segment with a pair of lock-free rings per client
+ *   channel, polled by the server. This is the fast path, it needs no
+ *   system calls per request.
+ *
+ * Requests arriving together are handled as one batch: consecutive
+ * predictions run as a lock step rollout over snapshots of the same state.
+ *
+ * The server never waits for a client. It takes no more requests from a
+ * shared memory channel than its response ring has room for, so a client
+ * that reads late stalls only its own channel and loses nothing. A response
+ * that doesn't fit a socket buffer is dropped and counted. Clients wait for
+ * the server with a timeout, and a lost response shows up as a gap in the
+ * sequence numbers; both throw rather than hang.
+ *
+ * A shared memory channel is claimed with the owner's pid, so a channel
+ * whose owner died is taken back by the next client that claims one. The
+ * server empties both rings of a channel before its new owner uses them.
+ */
+
+#pragma once
+
+#include "forward_declarations.hpp"
+#include "network.hpp"
+#include "ring_buffer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <initializer_list>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+namespace neural_network_tools {
+    enum serving_op_e : uint32_t {
+        PREDICT,    ///< Predict from the current state, without changing it
+        ADVANCE     ///< Feed the realised inputs and advance the network one step
+    };
+
+    enum serving_transport_e {
+        UNIX_SOCKET,
+        SHARED_MEMORY
+    };
+
+    template <typename N>
+    struct serving_request {
+        uint32_t op { PREDICT };
+        uint32_t seq { 0 };
+        std::array<accumulator_t, N::inputs_size> inputs {};
+    };
+
+    template <typename N>
+    struct serving_response {
+        uint32_t seq { 0 };
+        uint32_t status { 0 };
+        uint64_t step { 0 };
+        std::array<state_t, N::outputs_size> outputs {};
+    };
+
+    /**
+     * @brief Layout of the shared memory segment.
+     *
+     * @tparam N    Network type
+     * @tparam C    Client channel count
+     * @tparam D    Ring depth per channel
+     */
+    namespace detail {
+        [[noreturn]] inline void throw_errno(const char *what) {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        inline sockaddr_un unix_address(const std::string& path) {
+            sockaddr_un addr {};
+            addr.sun_family = AF_UNIX;
+            if (path.size() >= sizeof(addr.sun_path)) throw std::invalid_argument("Socket path too long");
+            std::copy(path.begin(), path.end(), addr.sun_path);
+            return addr;
+        }
+
+        /**
+         * @brief Make room in the send buffer of socket `fd` for two messages
+         * of `bytes`. The kernel caps it at `net.core.wmem_max`.
+         */
+        inline void reserve_send_buffer(const int fd, const size_t bytes) noexcept {
+            const int size = static_cast<int>(std::min<size_t>(2 * bytes, INT_MAX));
+            int current = 0;
+            socklen_t length = sizeof(current);
+            if (getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &current, &length) == 0 && current >= size) return;
+            setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+        }
+
+        /// Start of every shared memory segment, checked by clients before use.
+        struct segment_header {
+            uint64_t magic;
+            uint64_t bytes;     ///< Size of the whole segment
+            uint64_t layout;    ///< Fingerprint of the network layout, element types and segment parameters
+        };
+
+        /**
+         * @brief Fingerprint of network type `N`'s layout and element sizes,
+         * plus any segment `parameters`.
+         */
+        template <typename N>
+        constexpr uint64_t layout_fingerprint(const std::initializer_list<uint64_t> parameters) noexcept {
+            uint64_t h = 14695981039346656037ull; // FNV-1a over the bytes of each value
+            const auto add = [&h](uint64_t v) {
+                for (size_t i = 0; i < sizeof(v); ++i, v >>= 8) h = (h ^ (v & 0xff)) * 1099511628211ull;
+            };
+            for (const auto& l : N::layout) {
+                for (const uint64_t v : { uint64_t { l.size }, uint64_t { l.bias }, uint64_t { l.weights_size }, uint64_t { l.errors_size },
+                                          uint64_t { l.state_offset }, uint64_t { l.internal_weight_offset },
+                                          uint64_t { l.external_weight_offset }, uint64_t { l.errors_offset } }) {
+                    add(v);
+                }
+            }
+            for (const uint64_t v : { sizeof(accumulator_t), sizeof(state_t), sizeof(weight_t), sizeof(error_t) }) add(v);
+            for (const uint64_t v : parameters) add(v);
+            return h;
+        }
+
+        /**
+         * @brief Map shared memory segment `T`, creating it or attaching to an
+         * existing one of exactly `sizeof(T)` bytes.
+         */
+        template <typename T>
+        T *map_shared(const std::string& name, const bool create) {
+            const int fd = shm_open(name.c_str(), create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0600);
+            if (fd < 0) throw_errno("shm_open");
+            if (create && ftruncate(fd, sizeof(T)) < 0) {
+                close(fd);
+                throw_errno("ftruncate");
+            }
+            struct stat st;
+            if (!create && (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) != sizeof(T))) {
+                close(fd);
+                throw std::runtime_error("Shared memory segment " + name + " has the wrong size");
+            }
+            void *p = mmap(nullptr, sizeof(T), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED) throw_errno("mmap");
+            return static_cast<T *>(p);
+        }
+
+        /**
+         * @brief Attach to segment `T`, which must start with the header
+         * `T::identity()` describes.
+         */
+        template <typename T>
+        T *attach_shared(const std::string& name) {
+            T *const p = map_shared<T>(name, false);
+            const segment_header expected = T::identity();
+            if (p->header.magic != expected.magic || p->header.bytes != expected.bytes || p->header.layout != expected.layout) {
+                munmap(p, sizeof(T));
+                throw std::runtime_error("Shared memory segment " + name + " was made for another network type or layout");
+            }
+            return p;
+        }
+
+        /// Process id of the owner in a claim token.
+        inline pid_t claim_owner(const uint64_t token) noexcept {
+            return static_cast<pid_t>(token & 0xffffffff);
+        }
+
+        /// False once process `pid` is gone.
+        inline bool process_alive(const pid_t pid) noexcept {
+            return kill(pid, 0) == 0 || errno != ESRCH;
+        }
+
+        /**
+         * @brief Claim a free slot of a segment for this process.
+         *
+         * Slots whose owner process died are freed first. Tokens hold the
+         * owner pid in the low half and a claim count in the high half, so
+         * every claim is told apart from the previous owner of the slot, even
+         * one from the same process.
+         *
+         * @return Slot index, `C` if all slots are taken
+         */
+        template <size_t C>
+        size_t claim_slot(std::array<std::atomic<uint64_t>, C>& claimed, std::atomic<uint32_t>& claims, uint64_t& token) {
+            for (auto& c : claimed) {
+                auto t = c.load(std::memory_order_relaxed);
+                if (t && !process_alive(claim_owner(t))) c.compare_exchange_strong(t, 0);
+            }
+            token = static_cast<uint64_t>(claims.fetch_add(1) + 1) << 32 | static_cast<uint32_t>(getpid());
+            for (size_t i = 0; i < C; ++i) {
+                uint64_t expected = 0;
+                if (claimed[i].compare_exchange_strong(expected, token, std::memory_order_acq_rel)) return i;
+            }
+            return C;
+        }
+
+        /// Back off politely while waiting, so a waiting thread never starves the one it waits for.
+        inline void relax() noexcept {
+            std::this_thread::yield();
+        }
+    }
+
+    template <typename N, size_t C = 16, size_t D = 64>
+    struct serving_channels {
+        static constexpr const uint64_t magic_value { 0x6e6e742d73727632 }; // "nnt-srv2"
+        static constexpr const size_t channels { C };
+        static constexpr const size_t depth { D };
+
+        static constexpr detail::segment_header identity() noexcept {
+            return { magic_value, sizeof(serving_channels),
+                     detail::layout_fingerprint<N>({ C, D, sizeof(serving_request<N>), sizeof(serving_response<N>) }) };
+        }
+
+        detail::segment_header header { identity() };
+        std::atomic<uint32_t> claims { 0 };
+        std::array<std::atomic<uint64_t>, C> claimed {};    ///< Claim token of the owner, 0 when free
+        std::array<std::atomic<uint64_t>, C> opened {};     ///< Claim token the server emptied the rings for
+        std::array<spsc_ring<serving_request<N>, D>, C> requests;
+        std::array<spsc_ring<serving_response<N>, D>, C> responses;
+    };
+
+    /**
+     * @brief Serves predictions of one network over a Unix socket and/or
+     * shared memory.
+     *
+     * Single threaded: call `poll()` in a loop or hand a thread to `run()`.
+     * The server owns the socket file and shared memory name while it lives.
+     *
+     * @tparam N    Network type
+     * @tparam B    Maximum batch size
+     */
+    template <typename N, size_t B = 32>
+    class prediction_server {
+    public:
+        using request_t = serving_request<N>;
+        using response_t = serving_response<N>;
+        using channels_t = serving_channels<N>;
+
+    private:
+        struct pending {
+            int fd;             ///< Socket of the client, -1 for shared memory
+            size_t channel;     ///< Shared memory channel
+            request_t request;
+        };
+
+        N& net;
+        std::string socket_path;
+        std::string shm_name;
+        int listen_fd { -1 };
+        std::vector<int> clients;
+        channels_t *shm { nullptr };
+
+        std::array<pending, B> batch;
+        std::array<typename N::snapshot, B> snapshots;
+        size_t batch_size { 0 };
+
+        void accept_clients() {
+            for (;;) {
+                const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) return;
+                clients.push_back(fd);
+            }
+        }
+
+        void gather() {
+            batch_size = 0;
+            if (shm) {
+                for (size_t c = 0; c < channels_t::channels && batch_size < B; ++c) {
+                    const auto owner = shm->claimed[c].load(std::memory_order_acquire);
+                    if (owner != shm->opened[c].load(std::memory_order_relaxed)) {
+                        // New owner or none: drop whatever the previous one left behind
+                        shm->requests[c].reset();
+                        shm->responses[c].reset();
+                        shm->opened[c].store(owner, std::memory_order_release);
+                    }
+                    if (!owner) continue;
+                    // Only as many requests as there is room for responses, the channel stalls until its client reads
+                    size_t room = channels_t::depth - shm->responses[c].size();
+                    if (!room) {
+                        // A stalled channel is the first sign of a crashed client, free its channel
+                        auto o = owner;
+                        if (!detail::process_alive(detail::claim_owner(o))) shm->claimed[c].compare_exchange_strong(o, 0);
+                        continue;
+                    }
+                    while (room && batch_size < B && shm->requests[c].pop(batch[batch_size].request)) {
+                        batch[batch_size].fd = -1;
+                        batch[batch_size].channel = c;
+                        ++batch_size;
+                        --room;
+                    }
+                }
+            }
+            for (size_t i = 0; i < clients.size() && batch_size < B; ++i) {
+                while (batch_size < B) {
+                    const auto r = recv(clients[i], &batch[batch_size].request, sizeof(request_t), MSG_DONTWAIT);
+                    if (r == static_cast<ssize_t>(sizeof(request_t))) {
+                        batch[batch_size].fd = clients[i];
+                        ++batch_size;
+                    } else {
+                        if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                            close(clients[i]); // Client went away
+                            clients.erase(clients.begin() + i--);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+
+        /// Never waits. `gather()` left room in the response ring, a socket client that doesn't read loses responses.
+        void respond(const pending& p, const response_t& r) {
+            if (p.fd >= 0) {
+                if (send(p.fd, &r, sizeof(r), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(r))) ++dropped;
+            } else if (!shm->responses[p.channel].push(r)) {
+                ++dropped;
+            }
+        }
+
+        /// Run predictions `first` to `last` of the batch as one lock step rollout.
+        void predict(const size_t first, const size_t last) {
+            const auto base = net.fork();
+            for (size_t i = first; i < last; ++i) {
+                snapshots[i] = base;
+                std::copy(batch[i].request.inputs.begin(), batch[i].request.inputs.end(), snapshots[i].inputs());
+            }
+            net.rollout(snapshots.data() + first, snapshots.data() + last, 1, [](auto&, size_t) {});
+            for (size_t i = first; i < last; ++i) {
+                response_t r;
+                r.seq = batch[i].request.seq;
+                r.step = snapshots[i].step;
+                std::copy(snapshots[i].outputs(), snapshots[i].outputs() + N::outputs_size, r.outputs.begin());
+                respond(batch[i], r);
+            }
+        }
+
+        void process() {
+            size_t i = 0;
+            while (i < batch_size) {
+                if (batch[i].request.op == ADVANCE) {
+                    std::copy(batch[i].request.inputs.begin(), batch[i].request.inputs.end(), net.inputs);
+                    net.activate();
+                    response_t r;
+                    r.seq = batch[i].request.seq;
+                    r.step = net.step;
+                    std::copy(net.outputs, net.outputs + N::outputs_size, r.outputs.begin());
+                    respond(batch[i], r);
+                    ++i;
+                } else {
+                    auto j = i;
+                    while (j < batch_size && batch[j].request.op == PREDICT) ++j;
+                    predict(i, j);
+                    i = j;
+                }
+            }
+        }
+
+    public:
+        size_t served { 0 };
+        size_t batches { 0 };
+        size_t dropped { 0 };   ///< Responses lost to socket clients that didn't read them
+
+        /**
+         * @param n           Network to serve, must outlive the server
+         * @param socket      Unix socket path, empty to disable
+         * @param shm_segment Shared memory name (eg `/predictor`), empty to disable
+         */
+        prediction_server(N& n, const std::string& socket, const std::string& shm_segment = {})
+            : net { n }, socket_path { socket }, shm_name { shm_segment } {
+            if (!socket_path.empty()) {
+                listen_fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+                if (listen_fd < 0) detail::throw_errno("socket");
+                unlink(socket_path.c_str());
+                const auto addr = detail::unix_address(socket_path);
+                if (bind(listen_fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) < 0) detail::throw_errno("bind");
+                if (listen(listen_fd, 64) < 0) detail::throw_errno("listen");
+            }
+            if (!shm_name.empty()) {
+                shm = new (detail::map_shared<channels_t>(shm_name, true)) channels_t {};
+            }
+        }
+
+        prediction_server(const prediction_server&) = delete;
+        prediction_server& operator=(const prediction_server&) = delete;
+
+        ~prediction_server() {
+            for (const auto fd : clients) close(fd);
+            if (listen_fd >= 0) {
+                close(listen_fd);
+                unlink(socket_path.c_str());
+            }
+            if (shm) {
+                munmap(shm, sizeof(channels_t));
+                shm_unlink(shm_name.c_str());
+            }
+        }
+
+        /**
+         * @brief Serve one batch of whatever requests are waiting.
+         *
+         * @return Number of requests served
+         */
+        size_t poll() {
+            if (listen_fd >= 0) accept_clients();
+            gather();
+            if (!batch_size) return 0;
+            process();
+            served += batch_size;
+            ++batches;
+            return batch_size;
+        }
+
+        /**
+         * @brief Serve until `stop` is set. Busy polls for latency, but yields
+         * the core while idle.
+         */
+        void run(const std::atomic<bool>& stop) {
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (!poll()) detail::relax();
+            }
+        }
+    };
+
+    /**
+     * @brief Client side of a `prediction_server`.
+     *
+     * Not thread safe, use one client per thread.
+     */
+    template <typename N>
+    class prediction_client {
+    public:
+        using request_t = serving_request<N>;
+        using response_t = serving_response<N>;
+        using channels_t = serving_channels<N>;
+
+    private:
+        int fd { -1 };
+        channels_t *shm { nullptr };
+        size_t channel { 0 };
+        uint64_t token { 0 };
+        uint32_t seq { 0 };
+        uint32_t expected { 0 };    ///< Sequence number of the next response
+        std::chrono::milliseconds timeout;
+
+        /// Wait until `f()` holds, throw `what` after the timeout.
+        template <typename F>
+        void wait(F&& f, const char *what) const {
+            if (f()) return;
+            const auto deadline = std::chrono::steady_clock::now() + timeout;
+            while (!f()) {
+                if (std::chrono::steady_clock::now() > deadline) throw std::runtime_error(what);
+                detail::relax();
+            }
+        }
+
+    public:
+        /**
+         * @param transport Transport to use
+         * @param address   Socket path or shared memory name
+         * @param timeout   How long to wait for the server: to open the claimed
+         *                  channel, for room to send and for a response
+         */
+        prediction_client(const serving_transport_e transport, const std::string& address,
+                          const std::chrono::milliseconds timeout = std::chrono::seconds { 1 }) : timeout { timeout } {
+            if (transport == UNIX_SOCKET) {
+                fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+                if (fd < 0) detail::throw_errno("socket");
+                const auto addr = detail::unix_address(address);
+                const timeval tv { static_cast<time_t>(timeout.count() / 1000), static_cast<suseconds_t>(timeout.count() % 1000 * 1000) };
+                if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0 ||
+                    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) < 0 ||
+                    connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) < 0) {
+                    close(fd);
+                    detail::throw_errno("connect");
+                }
+            } else {
+                shm = detail::attach_shared<channels_t>(address);
+                channel = detail::claim_slot(shm->claimed, shm->claims, token);
+                if (channel == channels_t::channels) {
+                    munmap(shm, sizeof(channels_t));
+                    throw std::runtime_error("No free shared memory channel");
+                }
+                // The rings are ours once the server emptied them for this claim
+                const auto deadline = std::chrono::steady_clock::now() + timeout;
+                while (shm->opened[channel].load(std::memory_order_acquire) != token) {
+                    if (std::chrono::steady_clock::now() > deadline) {
+                        shm->claimed[channel].store(0, std::memory_order_release);
+                        munmap(shm, sizeof(channels_t));
+                        throw std::runtime_error("Prediction server didn't open the shared memory channel");
+                    }
+                    detail::relax();
+                }
+            }
+        }
+
+        prediction_client(const prediction_client&) = delete;
+        prediction_client& operator=(const prediction_client&) = delete;
+
+        ~prediction_client() {
+            if (fd >= 0) close(fd);
+            if (shm) {
+                shm->claimed[channel].store(0, std::memory_order_release);
+                munmap(shm, sizeof(channels_t));
+            }
+        }
+
+        /**
+         * @brief Send a request without waiting for the answer. Waits for
+         * room if the server is behind, and throws after the timeout: more
+         * than twice the ring depth of unread requests never fits.
+         *
+         * @return Sequence number of the request
+         */
+        uint32_t send(const serving_op_e op, const accumulator_t *const inputs) {
+            request_t r;
+            r.op = op;
+            r.seq = seq++;
+            std::copy(inputs, inputs + N::inputs_size, r.inputs.begin());
+            if (shm) {
+                auto& ring = shm->requests[channel];
+                wait([&] { return ring.push(r); }, "Prediction server didn't take the request in time");
+            } else if (::send(fd, &r, sizeof(r), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(r))) {
+                detail::throw_errno("send");
+            }
+            return r.seq;
+        }
+
+        /**
+         * @brief Wait for the next answer. Answers arrive in request order.
+         *
+         * Throws after the timeout, or if responses were lost in between;
+         * the next call picks up after the gap.
+         */
+        response_t receive() {
+            response_t r;
+            if (shm) {
+                auto& ring = shm->responses[channel];
+                wait([&] { return ring.pop(r); }, "Prediction server didn't answer in time");
+            } else if (recv(fd, &r, sizeof(r), 0) != static_cast<ssize_t>(sizeof(r))) {
+                detail::throw_errno("recv");
+            }
+            const bool lost = r.seq != expected;
+            expected = r.seq + 1;
+            if (lost) throw std::runtime_error("Prediction responses were lost");
+            return r;
+        }
+
+        response_t query(const serving_op_e op, const accumulator_t *const inputs) {
+            send(op, inputs);
+            return receive();
+        }
+    };
+}
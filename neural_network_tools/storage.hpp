@@ -0,0 +1,247 @@
+/**
+ * @brief Storage policies for the network buffers
+ *
+ * @file storage.hpp
+ *
+ * A storage policy decides where `network` keeps its accumulators, states,
+ * errors and weights. Each policy provides an `array<T, N>` template with the
+ * `std::array` interface the network relies on (`data()`, `operator[]`,
+ * iterators, `size()`), a `footprint<T, N>` in bytes, and a `detached`
+ * policy for copies of the state that live apart from any network, such as
+ * snapshots.
+ */
+
+#pragma once
+
+#include "default_configuration.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+#include <sys/mman.h>
+
+
+namespace neural_network_tools {
+    static constexpr const size_t cache_line_size { 64 };
+    static constexpr const size_t huge_page_size { 2 * 1024 * 1024 };
+
+    /// Owned buffers smaller than this stay on the heap even when huge pages are
+    /// asked for, a mapping of their own would round them up to a whole huge page.
+    static constexpr const size_t huge_page_threshold { huge_page_size };
+
+    constexpr size_t align_up(const size_t n, const size_t align) noexcept {
+        return (n + align - 1) / align * align;
+    }
+
+    /**
+     * @brief Allocate an aligned block, optionally asking for transparent
+     * huge pages.
+     *
+     * Huge page backed blocks are mapped directly and rounded up to whole
+     * huge pages, so only use them for large blocks such as a `slab`.
+     *
+     * @param bytes Block size
+     * @param align Alignment, a power of two
+     * @param huge  Back the block with transparent huge pages
+     */
+    inline void *allocate_aligned(const size_t bytes, const size_t align, const bool huge = false) {
+        if (huge) {
+            void *p = mmap(nullptr, align_up(bytes, huge_page_size), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+            madvise(p, align_up(bytes, huge_page_size), MADV_HUGEPAGE); // Only a hint, fine if refused
+#endif
+            return p;
+        }
+        void *p = std::aligned_alloc(align, align_up(std::max<size_t>(bytes, 1), align));
+        if (!p) throw std::bad_alloc();
+        return p;
+    }
+
+    inline void deallocate_aligned(void *const p, const size_t bytes, const bool huge = false) noexcept {
+        if (!p) return;
+        if (huge) {
+            munmap(p, align_up(bytes, huge_page_size));
+        } else {
+            std::free(p);
+        }
+    }
+
+    /**
+     * @brief Bump allocator over one large aligned block.
+     *
+     * Hands out consecutive aligned chunks and never frees them one by one,
+     * so any number of fixed size networks can be packed without
+     * fragmentation. Not thread safe; give each thread its own slab.
+     */
+    class slab {
+    private:
+        char *base { nullptr };
+        size_t capacity { 0 };
+        size_t used { 0 };
+        bool huge { false };
+
+    public:
+        /**
+         * @param bytes       Slab size
+         * @param huge_pages  Back the slab with transparent huge pages
+         */
+        explicit slab(const size_t bytes, const bool huge_pages = false)
+            : base { static_cast<char *>(allocate_aligned(bytes, cache_line_size, huge_pages)) },
+              capacity { bytes },
+              huge { huge_pages } {}
+
+        slab(const slab&) = delete;
+        slab& operator=(const slab&) = delete;
+
+        ~slab() { deallocate_aligned(base, capacity, huge); }
+
+        /**
+         * @brief Take the next chunk of `bytes` bytes, aligned to `align`.
+         */
+        void *allocate(const size_t bytes, const size_t align = cache_line_size) {
+            const size_t offset = align_up(reinterpret_cast<uintptr_t>(base) + used, align) - reinterpret_cast<uintptr_t>(base);
+            if (offset + bytes > capacity) throw std::bad_alloc();
+            used = offset + bytes;
+            return base + offset;
+        }
+
+        /**
+         * @brief Release all chunks at once. Anything allocated before is invalid afterwards.
+         */
+        void reset() noexcept { used = 0; }
+
+        size_t size() const noexcept { return used; }
+        size_t free() const noexcept { return capacity - used; }
+    };
+
+    /**
+     * @brief Buffers stored inside the network object, like plain `std::array`s.
+     *
+     * @tparam A Alignment in bytes
+     */
+    template <size_t A = cache_line_size>
+    struct inline_storage {
+        static constexpr const size_t alignment { A };
+
+        template <typename T, size_t N>
+        struct alignas(A) array : public std::array<T, N> {};
+
+        template <typename T, size_t N>
+        static constexpr size_t footprint = sizeof(array<T, N>);
+
+        using detached = inline_storage<A>;
+    };
+
+    /**
+     * @brief Fixed size buffer stored outside the object it is a member of.
+     *
+     * Either owns its block (allocated on construction) or views a block
+     * taken from a `slab`.
+     */
+    template <typename T, size_t N, size_t A, bool H, bool Owned>
+    class external_array {
+    private:
+        T *_data { nullptr };
+
+    public:
+        using value_type = T;
+        using iterator = T *;
+        using const_iterator = const T *;
+
+        static constexpr const size_t bytes { align_up(N * sizeof(T), A) };
+        static constexpr const bool huge { H && bytes >= huge_page_threshold };
+
+        template <bool O = Owned, typename = std::enable_if_t<O>>
+        external_array() : _data { static_cast<T *>(allocate_aligned(bytes, A, huge)) } {
+            std::fill(begin(), end(), T {});
+        }
+
+        template <bool O = Owned, typename = std::enable_if_t<!O>>
+        explicit external_array(slab& s) : _data { static_cast<T *>(s.allocate(bytes, A)) } {
+            std::fill(begin(), end(), T {});
+        }
+
+        external_array(const external_array& o) : _data { static_cast<T *>(allocate_aligned(bytes, A, huge)) } {
+            static_assert(Owned, "Slab backed buffers can't be copied, use save() and restore() instead");
+            std::copy(o.begin(), o.end(), begin());
+        }
+
+        external_array(external_array&& o) noexcept : _data { std::exchange(o._data, nullptr) } {}
+
+        /// Copy the elements. A moved from owned buffer allocates a new block first.
+        external_array& operator=(const external_array& o) {
+            if constexpr (Owned) {
+                if (!_data) _data = static_cast<T *>(allocate_aligned(bytes, A, huge));
+            }
+            std::copy(o.begin(), o.end(), begin());
+            return *this;
+        }
+
+        /// Swap blocks, `o` keeps the old one and stays usable.
+        external_array& operator=(external_array&& o) noexcept {
+            std::swap(_data, o._data);
+            return *this;
+        }
+
+        ~external_array() {
+            if constexpr (Owned) deallocate_aligned(_data, bytes, huge);
+        }
+
+        constexpr T *data() noexcept { return _data; }
+        constexpr const T *data() const noexcept { return _data; }
+        constexpr T& operator[](const size_t i) noexcept { return _data[i]; }
+        constexpr const T& operator[](const size_t i) const noexcept { return _data[i]; }
+        constexpr iterator begin() noexcept { return _data; }
+        constexpr iterator end() noexcept { return _data + N; }
+        constexpr const_iterator begin() const noexcept { return _data; }
+        constexpr const_iterator end() const noexcept { return _data + N; }
+        static constexpr size_t size() noexcept { return N; }
+        constexpr void fill(const T& v) noexcept { std::fill(begin(), end(), v); }
+    };
+
+    /**
+     * @brief Buffers in their own heap allocations, owned by the network.
+     *
+     * Keeps large networks off the stack.
+     *
+     * @tparam A Alignment in bytes
+     * @tparam H Back the buffers of at least `huge_page_threshold` bytes with
+     *           transparent huge pages. To put small networks on huge pages,
+     *           use `arena_storage` with a huge page backed slab instead.
+     */
+    template <size_t A = cache_line_size, bool H = false>
+    struct owned_storage {
+        static constexpr const size_t alignment { A };
+
+        template <typename T, size_t N>
+        using array = external_array<T, N, A, H, true>;
+
+        template <typename T, size_t N>
+        static constexpr size_t footprint = array<T, N>::bytes;
+
+        using detached = owned_storage<A, H>;
+    };
+
+    /**
+     * @brief Buffers taken from a caller provided `slab`, which must outlive
+     * the network. Networks using it are constructed with the slab as argument.
+     *
+     * @tparam A Alignment in bytes
+     */
+    template <size_t A = cache_line_size>
+    struct arena_storage {
+        static constexpr const size_t alignment { A };
+
+        template <typename T, size_t N>
+        using array = external_array<T, N, A, false, false>;
+
+        template <typename T, size_t N>
+        static constexpr size_t footprint = array<T, N>::bytes;
+
+        /// A snapshot has no slab to draw from, so it owns its buffers
+        using detached = owned_storage<A>;
+    };
+}
@@ -0,0 +1,239 @@
+/**
+ * @brief Run history without slowing down the training loop
+ *
+ * @file telemetry.hpp
+ *
+ * The training loop calls `record(net)` each step. Sampled records go into a
+ * lock-free ring, and a `telemetry_drain` thread passes them on to a sink,
+ * eg a `telemetry_log` file. With `no_telemetry` the call compiles away.
+ * Records are dropped, and counted, rather than ever blocking the loop when
+ * the consumer falls behind.
+ */
+
+#pragma once
+
+#include "forward_declarations.hpp"
+#include "ring_buffer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace neural_network_tools {
+    template <typename N>
+    struct telemetry_record {
+        uint64_t step;
+        uint64_t checked;       ///< Step of the last `check()`, `error` belongs to it
+        error_t error;          ///< Aggregated error as of step `checked`
+        weight_t weight_norm;   ///< L2 norm of all weights, refreshed every `health_every` records
+        state_t saturation;     ///< Fraction of hidden states near +-1, refreshed with `weight_norm`
+        std::array<state_t, N::outputs_size> outputs;
+    };
+
+    /**
+     * @brief Telemetry switched off, `record()` is a no-op.
+     */
+    struct no_telemetry {
+        static constexpr const bool enabled { false };
+
+        template <typename N>
+        constexpr void record(const N&) const noexcept {}
+    };
+
+    /**
+     * @brief Sampled telemetry for network type `N`, producer side.
+     *
+     * @tparam N    Network type
+     * @tparam D    Ring capacity in records, a power of two
+     */
+    template <typename N, size_t D = 4096>
+    class telemetry {
+    public:
+        using record_t = telemetry_record<N>;
+
+        static constexpr const bool enabled { true };
+
+    private:
+        spsc_ring<record_t, D> ring;
+        size_t every;
+        size_t health_every;
+        size_t since { 0 };
+        size_t since_health { 0 };
+        weight_t weight_norm { 0 };
+        state_t saturation { 0 };
+        std::atomic<uint64_t> dropped_records { 0 };
+
+        // Scans the full weight and state buffers, too slow for every record
+        void update_health(const N& net) noexcept {
+            weight_t sum = 0;
+            for (size_t i = 0; i < N::weights_size; ++i) {
+                sum += net.weights[i] * net.weights[i];
+            }
+            weight_norm = std::sqrt(sum);
+
+            // Real states of the hidden layers only, padding would dilute the ratio
+            size_t saturated = 0;
+            size_t hidden = 0;
+            N::for_each_state_run([&](const size_t o, const size_t n) {
+                if (o < N::hidden_offset || o >= N::outputs_offset) return;
+                for (size_t i = o; i < o + n; ++i) {
+                    saturated += std::abs(net.states[i]) > static_cast<state_t>(0.97);
+                }
+                hidden += n;
+            });
+            saturation = hidden ? static_cast<state_t>(saturated) / hidden : 0;
+        }
+
+    public:
+        /**
+         * @param every         Record one step in this many
+         * @param health_every  Refresh weight norm and saturation every this many records
+         */
+        explicit telemetry(const size_t every = 1, const size_t health_every = 64) noexcept :
+            every { every ? every : 1 },
+            health_every { health_every ? health_every : 1 },
+            since_health { this->health_every - 1 } {} // First record gets fresh values
+
+        telemetry(const telemetry&) = delete;
+        telemetry& operator=(const telemetry&) = delete;
+
+        /**
+         * @brief Record the current state of `net`. Producer side, call once per step.
+         */
+        void record(const N& net) noexcept {
+            if (likely(++since < every)) return;
+            since = 0;
+            if (unlikely(++since_health >= health_every)) {
+                since_health = 0;
+                update_health(net);
+            }
+            const bool written = ring.emplace([&](record_t& r) {
+                r.step = net.step;
+                r.checked = net.last_checked;
+                r.error = net.error;
+                r.weight_norm = weight_norm;
+                r.saturation = saturation;
+                for (size_t i = 0; i < N::outputs_size; ++i) {
+                    r.outputs[i] = net.outputs[i];
+                }
+            });
+            if (unlikely(!written)) {
+                dropped_records.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        /// Consumer side, see `telemetry_drain`.
+        bool pop(record_t& r) noexcept { return ring.pop(r); }
+
+        /// Records lost to a full ring.
+        uint64_t dropped() const noexcept { return dropped_records.load(std::memory_order_relaxed); }
+    };
+
+    /**
+     * @brief Consumer thread passing the records of a `telemetry` to a sink.
+     *
+     * The sink is called as `sink(const record_t&)` on the drain thread and
+     * is moved in; pass `std::ref(sink)` to keep it with the caller. On
+     * destruction the ring is drained completely before the thread exits.
+     */
+    template <typename T>
+    class telemetry_drain {
+    private:
+        std::atomic<bool> stop { false };
+        std::thread worker;
+
+    public:
+        template <typename F>
+        telemetry_drain(T& source, F&& sink) :
+            worker { [this, &source, sink = std::forward<F>(sink)]() mutable {
+                typename T::record_t r;
+                for (;;) {
+                    const bool stopping = stop.load(std::memory_order_acquire);
+                    bool any = false;
+                    while (source.pop(r)) {
+                        sink(r);
+                        any = true;
+                    }
+                    if (stopping) break;
+                    if (!any) std::this_thread::sleep_for(std::chrono::microseconds(100));
+                }
+            } } {}
+
+        telemetry_drain(const telemetry_drain&) = delete;
+        telemetry_drain& operator=(const telemetry_drain&) = delete;
+
+        ~telemetry_drain() {
+            stop.store(true, std::memory_order_release);
+            worker.join();
+        }
+    };
+
+    /**
+     * @brief Binary telemetry log sink.
+     *
+     * A small header followed by the raw records, readable on the same
+     * platform with `read()`.
+     */
+    template <typename N>
+    class telemetry_log {
+    public:
+        using record_t = telemetry_record<N>;
+
+    private:
+        struct header {
+            char magic[4] { 'N', 'N', 'T', 'T' };
+            uint32_t version { 2 };
+            uint32_t outputs { N::outputs_size };
+            uint32_t record_size { sizeof(record_t) };
+        };
+
+        std::FILE *file { nullptr };
+
+    public:
+        explicit telemetry_log(const std::string& path) : file { std::fopen(path.c_str(), "wb") } {
+            const header h {};
+            if (!file || std::fwrite(&h, sizeof(h), 1, file) != 1) {
+                if (file) std::fclose(file);
+                throw std::runtime_error("Can't write telemetry log " + path);
+            }
+        }
+
+        telemetry_log(telemetry_log&& o) noexcept : file { o.file } { o.file = nullptr; }
+        telemetry_log(const telemetry_log&) = delete;
+        telemetry_log& operator=(const telemetry_log&) = delete;
+
+        ~telemetry_log() {
+            if (file) std::fclose(file);
+        }
+
+        void operator()(const record_t& r) noexcept {
+            std::fwrite(&r, sizeof(r), 1, file);
+        }
+
+        /**
+         * @brief Read back a log written for the same network type.
+         */
+        static std::vector<record_t> read(const std::string& path) {
+            std::vector<record_t> records;
+            std::FILE *f = std::fopen(path.c_str(), "rb");
+            if (!f) throw std::runtime_error("Can't read telemetry log " + path);
+            header h;
+            const header expected {};
+            if (std::fread(&h, sizeof(h), 1, f) != 1 || std::memcmp(&h, &expected, sizeof(h))) {
+                std::fclose(f);
+                throw std::runtime_error("Not a telemetry log for this network: " + path);
+            }
+            record_t r;
+            while (std::fread(&r, sizeof(r), 1, f) == 1) {
+                records.push_back(r);
+            }
+            std::fclose(f);
+            return records;
+        }
+    };
+}
@@ -0,0 +1,90 @@
+#include "../all.hpp"
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+
+using namespace neural_network_tools;
+
+template <typename N>
+std::vector<state_t> run(const kernel_plan<N::layers_size>& plan) {
+    N::plan = plan;
+    N net;
+    net.set_weights();
+    std::vector<state_t> out;
+    for (int step = 0; step < 20; ++step) {
+        for (size_t i = 0; i < N::inputs_size; ++i) {
+            net.inputs[i] = static_cast<accumulator_t>(0.1 * (i + 1) + 0.05 * step);
+        }
+        net.activate();
+        for (size_t i = 0; i < N::outputs_size; ++i) {
+            out.push_back(net.outputs[i]);
+        }
+    }
+    N::plan = {};
+    return out;
+}
+
+/// Every variant must compute the same network, bit for bit, so plans never change results.
+template <typename N>
+bool check_variants(const char *name) {
+    const auto reference = run<N>({});
+    for (uint8_t d = 0; d < dense_kernel_count; ++d) {
+        for (uint8_t c = 0; c < gru_kernel_count; ++c) {
+            kernel_plan<N::layers_size> plan;
+            plan.dense.fill(d);
+            plan.cluster.fill(c);
+            const auto out = run<N>(plan);
+            for (size_t i = 0; i < out.size(); ++i) {
+                if (out[i] != reference[i]) {
+                    std::cout << name << ": dense " << unsigned(d) << ", cluster " << unsigned(c)
+                              << " differs at " << i << ": " << out[i] << " vs " << reference[i] << '\n';
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+int main() {
+    using packed_t = network<config<SUM_OF_SQUARE>, input<5>, gru<37, TANH>, gru<11, TANH, FAST_SIGMOID, FAST_SIGMOID, true>, output<3>>;
+    using padded_t = network<config<SUM_OF_SQUARE, inline_storage<64>, 64>, input<5>, gru<37, TANH>, gru<11, TANH>, output<3>>;
+
+    if (!check_variants<packed_t>("packed") || !check_variants<padded_t>("padded")) {
+        return 1;
+    }
+
+    const auto plan = autotuner<packed_t>::tune(50, 2);
+    std::cout << "Tuned plan:";
+    for (size_t i = 0; i < packed_t::layers_size; ++i) {
+        std::cout << ' ' << unsigned(plan.dense[i]) << '/' << unsigned(plan.cluster[i]);
+    }
+    std::cout << '\n';
+
+    const std::string path { "autotune_test.plan" };
+    if (!autotuner<packed_t>::save(plan, path)) {
+        std::cout << "Can't write " << path << '\n';
+        return 1;
+    }
+    kernel_plan<packed_t::layers_size> loaded;
+    if (!autotuner<packed_t>::load(loaded, path) || loaded != plan) {
+        std::cout << "Plan did not round trip\n";
+        return 1;
+    }
+    // A plan tuned for another network type must be rejected
+    kernel_plan<padded_t::layers_size> other;
+    if (autotuner<padded_t>::load(other, path)) {
+        std::cout << "Plan for another network type was accepted\n";
+        return 1;
+    }
+    if (autotuner<packed_t>::use(path) != plan || packed_t::plan != plan) {
+        std::cout << "Cached plan was not applied\n";
+        return 1;
+    }
+    std::remove(path.c_str());
+
+    std::cout << "All kernel variants agree\n";
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include "../all.hpp"
+
+#include <iostream>
+
+
+int main() {
+    using namespace neural_network_tools;
+
+    using small_t = network<config<SUM_OF_SQUARE>, input<3>, gru<4, TANH>, output<2>>;
+    using cost_t = cost_model<small_t>;
+
+    // input -> gru: 3x4 multiply-adds plus 4 bias adds
+    static_assert(cost_t::layers[0].flops == 2 * 3 * 4 + 4);
+    static_assert(cost_t::layers[0].weights == (3 + 1) * 4);
+    // gru: 14 flops, 2 fast sigmoids and a tanh per neuron, then 4x2 multiply-adds plus 2 bias adds
+    static_assert(cost_t::layers[1].flops == 4 * (14 + 3 + 3) + 2 * 4 * 2 + 2);
+    static_assert(cost_t::layers[1].transcendentals == 4);
+    static_assert(cost_t::layers[2].flops == 0);
+    static_assert(cost_t::total.weights == small_t::packed_weights_size);
+    static_assert(cost_t::total.flops == 28 + 98);
+
+    // Budgets
+    static_assert(cost_t::fits({ 126, 4 }));
+    static_assert(!cost_t::fits({ 125 }));
+    static_assert(!cost_t::fits({ 1'000, 3 }));
+
+    // Padding costs real work in the dense kernels
+    using padded_t = network<config<SUM_OF_SQUARE, inline_storage<64>, 64>, input<3>, gru<4, TANH>, output<2>>;
+    static_assert(cost_model<padded_t>::layers[0].flops == 2 * 3 * 16 + 16);
+    static_assert(cost_model<padded_t>::total.weights == cost_t::total.weights);
+    static_assert(cost_model<padded_t>::total.bytes > cost_t::total.bytes);
+
+    using filtered_t = network<config<SUM_OF_SQUARE>,
+                               steer_to_ideal<composite<input<2>, ratio<input<2>>>, composite<input<2>, ratio<input<2>>>>,
+                               mgu<40, TANH>,
+                               composite<output<2>, softmax<output<2>>>>;
+    static_assert(cost_model<filtered_t>::layers[0].flops == 2 * (4 * 2 + 3) + 2 * 8 * 40 + 40);
+    static_assert(cost_model<filtered_t>::layers[2].transcendentals == 2);
+
+    cost_model<filtered_t>::print(std::cout);
+    return 0;
+}
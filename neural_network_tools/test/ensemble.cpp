@@ -0,0 +1,81 @@
+#include "../all.hpp"
+
+#include <iostream>
+#include <memory>
+
+
+using namespace neural_network_tools;
+
+/// Members of an ensemble must match the networks they were loaded from.
+template <typename CFG, ensemble_combine_e EC>
+bool members_match(const bool report) {
+    using net_t = network<CFG,
+                          steer_to_ideal<composite<input<2>, ratio<input<2>>>,
+                                         composite<input<2>, ratio<input<2>>>>,
+                          gru<16, TANH>,
+                          composite<output<2>, ratio<output<2>>>
+                          >;
+    constexpr size_t M = 4;
+
+    std::array<net_t, M> nets;
+    auto ens = std::make_unique<ensemble<net_t, M, EC>>();
+
+    // Give every member its own weights, half from the packed array and half
+    // from the network, the two must load the same
+    for (size_t m = 0; m < M; ++m) {
+        std::array<weight_t, net_t::packed_weights_size> w;
+        for (size_t i = 0; i < w.size(); ++i) {
+            w[i] = -1 + i * (2.0 / w.size()) + (m * 0.37 + i * 0.11) * 0.01;
+        }
+        nets[m].set_weights(w);
+        if (m % 2) {
+            ens->set_weights(m, w);
+        } else {
+            ens->set_weights(m, nets[m]);
+        }
+    }
+
+    const state_t in[] { 2.5 * 60, 2.5 * 60, 0.2, 0.8, 2.5 * 60 + 3, 2.5 * 60 - 4, 0.25, 0.75 };
+
+    for (int step = 0; step < 20; ++step) {
+        for (size_t i = 0; i < net_t::inputs_size; ++i) {
+            ens->inputs[i] = in[i] + step * 0.01;
+            for (auto& n : nets) n.inputs[i] = in[i] + step * 0.01;
+        }
+        ens->activate();
+        for (auto& n : nets) n.activate();
+    }
+
+    for (size_t m = 0; m < M; ++m) {
+        for (size_t o = 0; o < net_t::outputs_size; ++o) {
+            if (abs(ens->member_output(m, o) - nets[m].outputs[o]) > 1e-5) {
+                std::cout << "Member " << m << " output " << o << " diverged: "
+                          << ens->member_output(m, o) << " != " << nets[m].outputs[o] << '\n';
+                return false;
+            }
+        }
+    }
+
+    if (report) {
+        for (size_t o = 0; o < net_t::outputs_size; ++o) {
+            std::cout << "Output " << o << ": " << ens->outputs[o] << " (spread " << ens->spread[o] << ")\n";
+        }
+        std::cout << "Confidence: " << ens->confidence() << '\n';
+    }
+    return true;
+}
+
+int main() {
+    if (!members_match<config<SUM_OF_SQUARE>, MEDIAN>(true)) return 1;
+    if (!members_match<config<SUM_OF_SQUARE, inline_storage<>, 32>, MEAN>(false)) {
+        std::cout << "Padded layout\n";
+        return 1;
+    }
+    if (!members_match<config<SUM_OF_SQUARE, owned_storage<>>, MEAN>(false)) {
+        std::cout << "Owned storage\n";
+        return 1;
+    }
+    using owned_ensemble_t = ensemble<network<config<SUM_OF_SQUARE, owned_storage<>>, input<2>, gru<16, TANH>, output<2>>, 4>;
+    static_assert(sizeof(owned_ensemble_t) < 256, "Ensemble buffers must follow the storage policy");
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "../all.hpp"
+#include "../evolution.hpp"
+
+#include <iostream>
+#include <memory>
+
+
+using namespace neural_network_tools;
+
+using net_t = network<config<SUM_OF_SQUARE>, input<2>, simple<6, TANH>, output<1>>;
+
+/// Minus the squared error of fitting y = x0 * x1 on a fixed grid.
+double fitness(net_t& net, uint64_t) {
+    double e = 0;
+    for (int a = -3; a <= 3; ++a) {
+        for (int b = -3; b <= 3; ++b) {
+            net.inputs[0] = a / 3.0f;
+            net.inputs[1] = b / 3.0f;
+            net.activate();
+            const double d = net.outputs[0] - a * b / 9.0;
+            e += d * d;
+        }
+    }
+    return -e;
+}
+
+std::unique_ptr<net_t> train(const size_t threads, const size_t generations, double& before, double& after) {
+    auto net = std::make_unique<net_t>();
+    net->set_weights_random(3);
+    es_settings s;
+    s.population = 40;
+    s.sigma = 0.05;
+    s.learning_rate = 0.05;
+    s.threads = threads;
+    es_trainer<net_t> trainer { *net, s };
+    before = trainer.evaluate(fitness);
+    for (size_t g = 0; g < generations; ++g) trainer.step(fitness);
+    after = trainer.evaluate(fitness);
+    return net;
+}
+
+int main() {
+    double before, after, b3, a3;
+    const auto one = train(1, 150, before, after);
+    const auto three = train(3, 150, b3, a3);
+
+    std::cout << "Fitness " << before << " -> " << after << " in 150 generations\n";
+    if (!(after > 0.5 * before)) {
+        std::cout << "Training did not halve the error\n";
+        return 1;
+    }
+    if (one->weights != three->weights || after != a3) {
+        std::cout << "Results depend on the thread count\n";
+        return 1;
+    }
+    return 0;
+}
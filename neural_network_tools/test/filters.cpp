@@ -0,0 +1,118 @@
+#include "../all.hpp"
+
+#include <chrono>
+#include <iostream>
+
+
+using namespace neural_network_tools;
+
+constexpr const size_t S { 7 };
+constexpr const state_t inputs[S] { 0.3, -1.2, 2.5, 0.0, 0.7, -0.4, 1.1 };
+
+template <typename T>
+std::array<state_t, S> run() {
+    std::array<accumulator_t, S> a;
+    std::array<state_t, S> s {};
+    std::copy(std::begin(inputs), std::end(inputs), a.begin());
+    T::activate(a.data(), s.data(), nullptr);
+    return s;
+}
+
+bool near(const state_t a, const state_t b) {
+    return std::abs(a - b) < 1e-5;
+}
+
+/// Lanes must match running each lane on its own.
+template <typename T>
+bool lanes_match() {
+    constexpr const size_t M { 4 };
+    std::array<accumulator_t, S * M> a;
+    std::array<state_t, S * M> s {};
+    for (size_t i = 0; i < S; ++i) {
+        for (size_t m = 0; m < M; ++m) {
+            a[i * M + m] = inputs[i] * (m + 1);
+        }
+    }
+    activate_interleaved<M, T>(a.data(), s.data(), nullptr);
+    for (size_t m = 0; m < M; ++m) {
+        std::array<accumulator_t, S> la;
+        std::array<state_t, S> ls {};
+        for (size_t i = 0; i < S; ++i) la[i] = inputs[i] * (m + 1);
+        T::activate(la.data(), ls.data(), nullptr);
+        for (size_t i = 0; i < S; ++i) {
+            if (!near(ls[i], s[i * M + m])) return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+double ns_per_activation() {
+    std::array<accumulator_t, S> a {};
+    std::array<state_t, S> s {};
+    constexpr const size_t reps { 1'000'000 };
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < reps; ++r) {
+        std::copy(std::begin(inputs), std::end(inputs), a.begin());
+        T::activate(a.data(), s.data(), nullptr);
+        asm volatile("" ::: "memory");
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / reps;
+}
+
+int main() {
+    using plain_t = output<S>;
+
+    const auto shifted = run<shift_normalise<plain_t>>();
+    state_t mean = 0;
+    for (const auto x : shifted) mean += x;
+    for (size_t i = 0; i < S; ++i) {
+        if (!near(shifted[i], inputs[i] - static_cast<state_t>(3.0 / S))) {
+            std::cout << "shift_normalise: wrong state " << i << '\n';
+            return 1;
+        }
+    }
+
+    const auto r = run<ratio<plain_t>>();
+    state_t sum = 0;
+    for (const auto x : r) sum += x;
+    if (!near(sum, 1) || !near(*std::min_element(r.begin(), r.end()), 0) || !near(r[2], (2.5 + 1.2) / (3.0 + S * 1.2))) {
+        std::cout << "ratio: wrong states\n";
+        return 1;
+    }
+
+    const auto sm = run<softmax<plain_t>>();
+    state_t exp_sum = 0;
+    for (const auto x : inputs) exp_sum += std::exp(x);
+    for (size_t i = 0; i < S; ++i) {
+        if (!near(sm[i], std::exp(inputs[i]) / exp_sum)) {
+            std::cout << "softmax: wrong state " << i << '\n';
+            return 1;
+        }
+    }
+
+    // Nested filters see the final states of the inner one
+    const auto nested = run<ratio<shift_normalise<plain_t>>>();
+    for (size_t i = 0; i < S; ++i) {
+        if (!near(nested[i], r[i])) {
+            std::cout << "ratio<shift_normalise>: wrong state " << i << '\n';
+            return 1;
+        }
+    }
+    const auto mixed = run<composite<softmax<output<3>>, ratio<output<4>>>>();
+    if (!near(mixed[0] + mixed[1] + mixed[2], 1) || !near(mixed[3] + mixed[4] + mixed[5] + mixed[6], 1)) {
+        std::cout << "composite: filters leak across members\n";
+        return 1;
+    }
+
+    if (!lanes_match<shift_normalise<plain_t>>() || !lanes_match<ratio<plain_t>>() || !lanes_match<softmax<plain_t>>()) {
+        std::cout << "Interleaved lanes differ from single instances\n";
+        return 1;
+    }
+
+    std::cout << "ns per activation: plain " << ns_per_activation<plain_t>()
+              << ", shift_normalise " << ns_per_activation<shift_normalise<plain_t>>()
+              << ", ratio " << ns_per_activation<ratio<plain_t>>()
+              << ", softmax " << ns_per_activation<softmax<plain_t>>() << '\n';
+    return 0;
+}
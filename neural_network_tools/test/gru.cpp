@@ -0,0 +1,82 @@
+#include "../all.hpp"
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+
+using namespace neural_network_tools;
+
+/**
+ * Reference GRU step. Per neuron weights: reset gate (input, state[, bias]),
+ * update gate (input, state[, bias]), candidate state (input, reset state[, bias]).
+ */
+template <bool GB>
+state_t reference(const accumulator_t a, const state_t s, const weight_t *const w) {
+    constexpr size_t k { GB ? 3 : 2 };
+    const auto bias = [&](const size_t g) { return GB ? w[g * k + 2] : weight_t {}; };
+    const state_t r = activation<FAST_SIGMOID>::run(w[0] * a + w[1] * s + bias(0));
+    const state_t u = activation<FAST_SIGMOID>::run(w[k] * a + w[k + 1] * s + bias(1));
+    const state_t c = activation<TANH>::run(w[2 * k] * a + w[2 * k + 1] * (r * s) + bias(2));
+    return (1 - u) * s + u * c;
+}
+
+template <bool GB>
+bool check(const char *name) {
+    constexpr size_t S { 3 };
+    constexpr size_t M { 2 };
+    constexpr size_t per_neuron { GB ? 9 : 6 };
+    using T = gru<S, TANH, FAST_SIGMOID, FAST_SIGMOID, GB>;
+    static_assert(T::weights_size == S * per_neuron, "GRU weight count");
+
+    // A poisoned tail catches reads past the cluster's own weights
+    std::array<weight_t, T::weights_size * M + 2 * per_neuron> w;
+    w.fill(std::numeric_limits<weight_t>::quiet_NaN());
+    for (size_t i = 0; i < T::weights_size; ++i) {
+        w[i] = static_cast<weight_t>(0.15 * (i % 7) - 0.4);
+    }
+    const accumulator_t a0[S] { 0.5f, -1, 2 };
+    const state_t s0[S] { 0.25f, -0.5f, 0 };
+
+    bool ok = true;
+    const auto compare = [&](const char *kernel, const size_t i, const state_t got) {
+        const state_t want = reference<GB>(a0[i], s0[i], &w[i * per_neuron]);
+        if (!std::isfinite(got) || std::abs(got - want) > 1e-6f) {
+            std::cout << name << ' ' << kernel << " neuron " << i << ": " << got << ", expected " << want << '\n';
+            ok = false;
+        }
+    };
+
+    accumulator_t a[S];
+    state_t s[S];
+    std::copy(a0, a0 + S, a);
+    std::copy(s0, s0 + S, s);
+    T::activate(a, s, w.data());
+    for (size_t i = 0; i < S; ++i) compare("scalar", i, s[i]);
+
+    // Interleaved lanes: value g of neuron i, lane m at [(i * stride + g) * M + m]
+    std::array<weight_t, T::weights_size * M + 2 * per_neuron> wl;
+    wl.fill(std::numeric_limits<weight_t>::quiet_NaN());
+    accumulator_t al[S * M];
+    state_t sl[S * M];
+    for (size_t i = 0; i < S; ++i) {
+        for (size_t m = 0; m < M; ++m) {
+            for (size_t g = 0; g < per_neuron; ++g) wl[(i * per_neuron + g) * M + m] = w[i * per_neuron + g];
+            al[i * M + m] = a0[i];
+            sl[i * M + m] = s0[i];
+        }
+    }
+    T::template activate_lanes<M>(al, sl, wl.data());
+    for (size_t i = 0; i < S; ++i) {
+        for (size_t m = 0; m < M; ++m) compare("lanes", i, sl[i * M + m]);
+    }
+    return ok;
+}
+
+int main() {
+    bool ok = check<false>("gru");
+    ok &= check<true>("gru with gate bias");
+    if (!ok) return 1;
+    std::cout << "GRU gates match the reference, with and without gate bias\n";
+    return 0;
+}
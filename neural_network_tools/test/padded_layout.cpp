@@ -0,0 +1,73 @@
+#include "../all.hpp"
+
+#include <iostream>
+#include <vector>
+
+
+int main() {
+    using namespace neural_network_tools;
+
+    using packed_t = network<config<SUM_OF_SQUARE>,
+                             steer_to_ideal<input<2>, input<2>>,
+                             gru<13, TANH>,
+                             composite<output<2>, ratio<output<2>>>>;
+    using padded_t = network<config<SUM_OF_SQUARE, inline_storage<64>, 64>,
+                             steer_to_ideal<input<2>, input<2>>,
+                             gru<13, TANH>,
+                             composite<output<2>, ratio<output<2>>>>;
+
+    static_assert(packed_t::save_bytes == padded_t::save_bytes, "Checkpoints must not grow");
+    static_assert(padded_t::weights_size > packed_t::weights_size);
+
+    packed_t a;
+    padded_t b;
+
+    std::cout << "Weights: " << packed_t::weights_size << " packed, " << padded_t::weights_size << " padded\n";
+
+    if (reinterpret_cast<uintptr_t>(b.outputs) % 64) {
+        std::cout << "Output layer is not aligned\n";
+        return 1;
+    }
+
+    const state_t in[] { 2.5 * 60, 0.2, 2.5 * 60 + 5, 0.3 };
+    for (int step = 0; step < 25; ++step) {
+        for (size_t i = 0; i < packed_t::inputs_size; ++i) {
+            a.inputs[i] = in[i] + step * 0.1;
+            b.inputs[i] = in[i] + step * 0.1;
+        }
+        a.activate();
+        b.activate();
+        a.check();
+        b.check();
+    }
+
+    std::vector<char> sa(packed_t::save_bytes), sb(padded_t::save_bytes);
+    a.save(sa.data());
+    b.save(sb.data());
+    if (sa != sb) {
+        std::cout << "Padded checkpoint differs from packed\n";
+        return 1;
+    }
+
+    // Restoring a packed checkpoint into a padded network continues identically
+    padded_t c;
+    c.restore(sa.data());
+    for (size_t i = 0; i < packed_t::inputs_size; ++i) {
+        a.inputs[i] = in[i];
+        c.inputs[i] = in[i];
+    }
+    a.activate();
+    c.activate();
+
+    for (size_t o = 0; o < packed_t::outputs_size; ++o) {
+        std::cout << "Output " << o << ": " << a.outputs[o] << '\n';
+        if (a.outputs[o] != c.outputs[o]) {
+            std::cout << "Padded layout diverged\n";
+            return 1;
+        }
+    }
+    if (a.error != b.error) {
+        std::cout << "Padded errors diverged\n";
+        return 1;
+    }
+}
@@ -0,0 +1,146 @@
+#include "../all.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+
+using namespace neural_network_tools;
+using extra_math::philox4x32;
+
+/// Known answers from the Random123 distribution (kat_vectors, philox4x32 10 rounds).
+bool known_answers() {
+    struct kat {
+        uint64_t seed;
+        uint64_t block;
+        uint64_t instance;
+        philox4x32::block_t expected;
+    };
+    const kat kats[] {
+        { 0, 0, 0, { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+        { ~0ull, ~0ull, ~0ull, { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+        { 0x299f31d0a4093822, 0x85a308d3243f6a88, 0x0370734413198a2e, { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } }
+    };
+    for (const auto& k : kats) {
+        if (philox4x32 { k.seed, k.instance }.generate(k.block) != k.expected) {
+            std::cout << "Known answer mismatch\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+/// The same values however a fill is split up, and the same words as the URBG interface.
+template <typename T>
+bool split_invariant() {
+    const philox4x32 rng { 42, 3 };
+    constexpr const size_t n { 1001 };
+    std::vector<T> whole(n), parts(n), normal(n), normal_parts(n);
+    rng.fill_uniform(whole.data(), n);
+    rng.fill_normal(normal.data(), n);
+
+    // Uneven slices on several threads, starting at odd positions
+    const size_t cuts[] { 0, 1, 7, 64, 65, 333, 600, 999, n };
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c + 1 < std::size(cuts); ++c) {
+        threads.emplace_back([&, c] {
+            rng.fill_uniform(&parts[cuts[c]], cuts[c + 1] - cuts[c], cuts[c]);
+            rng.fill_normal(&normal_parts[cuts[c]], cuts[c + 1] - cuts[c], cuts[c]);
+        });
+    }
+    for (auto& t : threads) t.join();
+    if (whole != parts || normal != normal_parts) {
+        std::cout << "Split fills differ\n";
+        return false;
+    }
+
+    if constexpr (std::is_same_v<T, float>) {
+        philox4x32 urbg { 42, 3 };
+        for (size_t i = 0; i < n; ++i) {
+            if (static_cast<float>(urbg() >> 8) / (1 << 24) != whole[i]) {
+                std::cout << "URBG words differ from the bulk fill\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool moments() {
+    constexpr const size_t n { 1 << 20 };
+    std::vector<double> u(n), z(n);
+    const philox4x32 rng { 7 };
+    rng.fill_uniform(u.data(), n, 0, -1.0, 1.0);
+    rng.split(1).fill_normal(z.data(), n, 0, 2.0, 3.0);
+
+    double um = 0, zm = 0, zv = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (u[i] < -1 || u[i] >= 1) return false;
+        um += u[i];
+        zm += z[i];
+    }
+    um /= n;
+    zm /= n;
+    for (const auto x : z) zv += (x - zm) * (x - zm);
+    zv /= n;
+    if (std::abs(um) > 0.005 || std::abs(zm - 2) > 0.01 || std::abs(zv - 9) > 0.05) {
+        std::cout << "Moments off: uniform mean " << um << ", normal mean " << zm << ", variance " << zv << '\n';
+        return false;
+    }
+    return true;
+}
+
+bool weights() {
+    using packed_t = network<config<SUM_OF_SQUARE>, input<3>, gru<13, TANH>, output<2>>;
+    using padded_t = network<config<SUM_OF_SQUARE, inline_storage<64>, 64>, input<3>, gru<13, TANH>, output<2>>;
+    auto a = std::make_unique<packed_t>();
+    auto b = std::make_unique<padded_t>();
+    auto c = std::make_unique<packed_t>();
+    a->set_weights_random(5, 1);
+    b->set_weights_random(5, 1);
+    c->set_weights_random(5, 2);
+
+    std::array<char, packed_t::save_bytes> sa, sb;
+    a->save(sa.data());
+    b->save(sb.data());
+    if (sa != sb) {
+        std::cout << "Padding changes the random weights\n";
+        return false;
+    }
+    if (a->weights == c->weights) {
+        std::cout << "Instances share their weights\n";
+        return false;
+    }
+    for (const auto w : a->weights) {
+        if (w < -1 || w >= 1) return false;
+    }
+    return true;
+}
+
+void benchmark() {
+    constexpr const size_t n { 1 << 22 };
+    std::vector<float> out(n);
+    using clock = std::chrono::steady_clock;
+
+    const auto s0 = clock::now();
+    std::mt19937 e { 1 };
+    std::uniform_real_distribution<float> d { -1, 1 };
+    for (auto& x : out) x = d(e);
+    const auto s1 = clock::now();
+    philox4x32 { 1 }.fill_uniform(out.data(), n, 0, -1.0f, 1.0f);
+    const auto s2 = clock::now();
+
+    std::cout << "ns per uniform float: mt19937 " << std::chrono::duration<double, std::nano>(s1 - s0).count() / n
+              << ", philox bulk " << std::chrono::duration<double, std::nano>(s2 - s1).count() / n << '\n';
+}
+
+int main() {
+    if (!known_answers() || !split_invariant<float>() || !split_invariant<double>() || !moments() || !weights()) {
+        return 1;
+    }
+    benchmark();
+    return 0;
+}
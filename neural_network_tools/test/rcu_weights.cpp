@@ -0,0 +1,59 @@
+#include "../all.hpp"
+#include "../rcu_weights.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+
+int main() {
+    using namespace neural_network_tools;
+    using net_t = network<config<SUM_OF_SQUARE>, input<3>, gru<32, TANH>, output<2>>;
+
+    net_t trainer;
+    rcu_weights<net_t> shared { trainer };
+    std::atomic<bool> stop { false };
+    std::atomic<size_t> torn { 0 };
+    std::atomic<size_t> predictions { 0 };
+
+    // Inference threads: every pinned set must be internally consistent
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&] {
+            net_t net;
+            rcu_weights<net_t>::reader r { shared };
+            uint64_t last_version = 0;
+            while (!stop) {
+                const auto& set = r.lock();
+                const auto v = set.version;
+                for (const auto w : set.weights) {
+                    if (v && w != static_cast<weight_t>(v)) {
+                        ++torn;
+                        break;
+                    }
+                }
+                if (v < last_version) ++torn;
+                last_version = v;
+                net.activate(set.weights.data());
+                r.unlock();
+                ++predictions;
+                std::this_thread::yield(); // Keep the test short on machines with few cores
+            }
+        });
+    }
+
+    // Training thread: update the private copy, then publish it
+    for (int v = 1; v <= 2000; ++v) {
+        for (auto& w : trainer.weights) w = v;
+        shared.publish(trainer.weights);
+        // Let the readers make progress in between, even on a single core
+        for (const auto p = predictions.load(); predictions - p < 3;) std::this_thread::yield();
+    }
+    stop = true;
+    for (auto& r : readers) r.join();
+
+    std::cout << "Published " << shared.version() << " weight sets, "
+              << predictions << " predictions, " << torn << " inconsistent\n";
+    return torn ? 1 : 0;
+}
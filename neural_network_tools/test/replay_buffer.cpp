@@ -0,0 +1,144 @@
+#include "../all.hpp"
+
+#include <iostream>
+#include <memory>
+#include <random>
+
+
+using namespace neural_network_tools;
+
+using net_t = network<config<SUM_OF_SQUARE>,
+                      steer_to_ideal<input<2>, input<2>>,
+                      gru<8, TANH>,
+                      output<2>>;
+
+void set_inputs(net_t& net, const size_t k) {
+    net.inputs[0] = 1;
+    net.inputs[1] = 0.5;
+    net.inputs[2] = static_cast<accumulator_t>(1 + 0.1 * (k % 7));
+    net.inputs[3] = static_cast<accumulator_t>(0.5 - 0.05 * (k % 5));
+}
+
+/// Replaying a recorded step must reproduce the live step exactly.
+template <replay_sampling_e RS>
+bool replay_matches() {
+    auto net = std::make_unique<net_t>();
+    auto buffer = std::make_unique<replay_buffer<net_t, 16, RS>>();
+    std::array<state_t, net_t::outputs_size> outputs[40];
+    neural_network_tools::error_t errors[40];
+    size_t index[40];
+
+    for (size_t k = 0; k < 40; ++k) {
+        set_inputs(*net, k);
+        index[k] = buffer->record(*net);
+        net->activate();
+        net->check();
+        buffer->update(index[k], net->error);
+        std::copy(net->outputs, net->outputs + net_t::outputs_size, outputs[k].begin());
+        errors[k] = net->error;
+    }
+    if (buffer->size() != 16 || (*buffer)[index[39]].snap.step != 39 || (*buffer)[index[24]].snap.step != 24) {
+        std::cout << "Ring holds the wrong steps\n";
+        return false;
+    }
+
+    const auto live = net->fork();
+    for (size_t k = 24; k < 40; ++k) {
+        if (buffer->replay(*net, index[k]) != errors[k] ||
+            !std::equal(outputs[k].begin(), outputs[k].end(), net->outputs) || net->step != k + 1) {
+            std::cout << "Replay of step " << k << " differs from the live step\n";
+            return false;
+        }
+    }
+    net->restore(live);
+
+    // Batches leave the live state alone and hand `f` the replayed step
+    std::mt19937_64 g { 1 };
+    const auto live_errors = net->errors;
+    replay_batch<8> batch;
+    buffer->draw(g, batch);
+    size_t calls = 0;
+    bool ok = true;
+    buffer->replay(*net, batch, [&](net_t& n, const size_t i, const neural_network_tools::error_t) {
+        ok &= n.step == (*buffer)[i].snap.step + 1 && n.last_learned == 0;
+        ++calls;
+    });
+    const auto after = net->fork();
+    if (!ok || calls != 8 || after.step != live.step || after.states != live.states || net->error != errors[39] ||
+        !std::equal(live_errors.begin(), live_errors.end(), net->errors.begin())) {
+        std::cout << "Batch replay disturbed the live network\n";
+        return false;
+    }
+    return true;
+}
+
+bool prioritised_proportions() {
+    auto net = std::make_unique<net_t>();
+    auto buffer = std::make_unique<replay_buffer<net_t, 10, PRIORITISED>>();
+    buffer->alpha = 1;
+    buffer->epsilon = 0;
+    for (size_t i = 0; i < 10; ++i) {
+        buffer->record(*net);
+        buffer->update(i, i == 3 ? 10 : 1); // Sample 3 holds 10 of the total 19
+    }
+
+    std::mt19937_64 g { 7 };
+    replay_batch<32> batch;
+    size_t hits[10] {};
+    constexpr const size_t rounds { 2000 };
+    for (size_t r = 0; r < rounds; ++r) {
+        buffer->draw(g, batch);
+        for (const auto i : batch.indices) ++hits[i];
+    }
+    const double share = static_cast<double>(hits[3]) / (rounds * batch.size);
+    if (std::abs(share - 10.0 / 19) > 0.01) {
+        std::cout << "Prioritised share " << share << ", expected " << 10.0 / 19 << '\n';
+        return false;
+    }
+    for (size_t i = 0; i < 10; ++i) {
+        if (i != 3 && std::abs(static_cast<double>(hits[i]) / (rounds * batch.size) - 1.0 / 19) > 0.01) {
+            std::cout << "Sample " << i << " drawn off its priority\n";
+            return false;
+        }
+    }
+
+    // The high priority sample gets the smallest importance weight
+    buffer->beta = 1;
+    buffer->draw(g, batch);
+    for (size_t b = 0; b < batch.size; ++b) {
+        const auto expected = batch.indices[b] == 3 ? 0.1f : 1.0f;
+        if (std::abs(batch.weights[b] - expected) > 1e-5) {
+            std::cout << "Wrong importance weight " << batch.weights[b] << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+bool uniform_spread() {
+    auto net = std::make_unique<net_t>();
+    auto buffer = std::make_unique<replay_buffer<net_t, 5>>();
+    for (size_t i = 0; i < 5; ++i) buffer->record(*net);
+
+    std::mt19937_64 g { 3 };
+    replay_batch<16> batch;
+    size_t hits[5] {};
+    for (size_t r = 0; r < 5000; ++r) {
+        buffer->draw(g, batch);
+        for (const auto i : batch.indices) ++hits[i];
+    }
+    for (const auto h : hits) {
+        if (std::abs(h / 80000.0 - 0.2) > 0.01) {
+            std::cout << "Uniform draws are skewed\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    if (!replay_matches<UNIFORM>() || !replay_matches<PRIORITISED>() || !prioritised_proportions() || !uniform_spread()) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include "../all.hpp"
+
+#include <iostream>
+#include <vector>
+
+
+int main() {
+    using namespace neural_network_tools;
+
+    network<config<SUM_OF_SQUARE>,
+            input<3>,
+            gru<5, TANH>,
+            output<2>
+            > net;
+
+    net.inputs[0] = 2.5 * 60;
+    net.inputs[1] = 2.5 * 60;
+    net.inputs[2] = 0.2;
+
+    for (int i = 0; i < 10; ++i) net.activate();
+
+    const auto before = net.fork();
+
+    // Candidate futures: vary the realised time input per branch
+    std::vector<decltype(net)::snapshot> branches(4, before);
+    net.rollout(branches.begin(), branches.end(), 8, [&](auto& snap, size_t) {
+        snap.inputs()[1] = 2.5 * 60 + (&snap - branches.data()) * 10;
+    });
+
+    // The network itself must be untouched by the rollouts
+    if (net.step != before.step || net.states != before.states) {
+        std::cout << "Rollout modified the network state\n";
+        return 1;
+    }
+
+    // A rollout must match the same steps taken on the network
+    for (size_t b = 0; b < branches.size(); ++b) {
+        net.restore(before);
+        for (int i = 0; i < 8; ++i) {
+            net.inputs[1] = 2.5 * 60 + b * 10;
+            net.activate();
+        }
+        for (size_t i = 0; i < net.outputs_size; ++i) {
+            std::cout << "Branch " << b << " output " << i << ": " << branches[b].outputs()[i] << '\n';
+            if (net.outputs[i] != branches[b].outputs()[i]) {
+                std::cout << "Rollout diverged from network\n";
+                return 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#include "../all.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+
+using namespace neural_network_tools;
+
+using net_t = network<config<SUM_OF_SQUARE>,
+                      steer_to_ideal<input<2>, input<2>>,
+                      simple<6, TANH>,
+                      output<2>>;
+
+/// Targets fixed, realisations wobbling slightly around them, plus `jump` from step `at` on.
+void set_inputs(net_t& net, const size_t k, const size_t at = ~size_t {}, const float jump = 0) {
+    net.inputs[0] = 1;
+    net.inputs[1] = 0.5;
+    net.inputs[2] = static_cast<accumulator_t>(1 + 0.01 * (k % 7) + (k >= at ? jump : 0));
+    net.inputs[3] = static_cast<accumulator_t>(0.5 - 0.005 * (k % 5));
+}
+
+template <schedule_policy_e P>
+std::unique_ptr<check_schedule<net_t, P>> run(const schedule_settings& s, const size_t steps, const size_t at = ~size_t {}, const float jump = 0,
+                                              size_t *const first_check_after = nullptr) {
+    auto net = std::make_unique<net_t>();
+    net->set_weights_random(5);
+    auto schedule = std::make_unique<check_schedule<net_t, P>>(s);
+    for (size_t k = 0; k < steps; ++k) {
+        net->activate();
+        set_inputs(*net, k, at, jump);
+        const auto a = schedule->run(*net);
+        if (a.learned && net->last_checked != net->step) {
+            std::cout << "Learned without a check at step " << net->step << '\n';
+            std::exit(1);
+        }
+        if (first_check_after && k >= at && a.checked && *first_check_after == ~size_t {}) *first_check_after = k - at;
+    }
+    return schedule;
+}
+
+int main() {
+    schedule_settings fixed;
+    fixed.stride = 4;
+    fixed.learn_stride = 3;
+    const auto f = run<FIXED_STRIDE>(fixed, 1000);
+    if (f->checks != 250 || f->learns != 83 || f->stride() != 4) {
+        std::cout << "Fixed stride: " << f->checks << " checks and " << f->learns << " learns, expected 250 and 83\n";
+        return 1;
+    }
+
+    const auto p = run<PLATEAU_BACKOFF>({}, 10000);
+    std::cout << "Plateau back-off checked " << p->checks << " of " << p->steps << " steps, stride " << p->stride() << '\n';
+    if (p->checks * 10 > p->steps) {
+        std::cout << "Steady inputs did not back off\n";
+        return 1;
+    }
+
+    size_t after = ~size_t {};
+    const auto s = run<SPIKE_TRIGGER>({}, 10000, 5000, 5, &after);
+    std::cout << "Spike trigger checked " << s->checks << " of " << s->steps << " steps, " << s->spikes << " spikes\n";
+    if (after != 0 || !s->spikes) {
+        std::cout << "Input jump checked " << after << " steps late\n";
+        return 1;
+    }
+    if (s->checks * 10 > s->steps) {
+        std::cout << "Spike trigger did not back off\n";
+        return 1;
+    }
+    return 0;
+}
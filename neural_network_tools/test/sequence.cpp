@@ -0,0 +1,90 @@
+#include "../all.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+
+using namespace neural_network_tools;
+
+template <typename N>
+std::vector<accumulator_t> make_inputs(const size_t t) {
+    std::vector<accumulator_t> in(t * N::inputs_size);
+    for (size_t k = 0; k < t; ++k) {
+        for (size_t i = 0; i < N::inputs_size; ++i) {
+            in[k * N::inputs_size + i] = static_cast<accumulator_t>(0.3 + 0.1 * i + 0.05 * ((k * 7 + i) % 11));
+        }
+    }
+    return in;
+}
+
+/// The sequence API must leave the network exactly where single steps do.
+template <typename N>
+bool check(const char *name, const size_t t) {
+    const auto in = make_inputs<N>(t);
+    auto a = std::make_unique<N>();
+    auto b = std::make_unique<N>();
+
+    std::vector<state_t> expected(t * N::outputs_size);
+    for (size_t k = 0; k < t; ++k) {
+        std::copy(&in[k * N::inputs_size], &in[(k + 1) * N::inputs_size], a->inputs);
+        a->activate();
+        std::copy(a->outputs, a->outputs + N::outputs_size, &expected[k * N::outputs_size]);
+    }
+
+    std::vector<state_t> out(t * N::outputs_size);
+    b->activate_sequence(in.data(), out.data(), t);
+
+    for (size_t i = 0; i < out.size(); ++i) {
+        if (std::abs(out[i] - expected[i]) > 1e-5 * (1 + std::abs(expected[i]))) {
+            std::cout << name << ": output " << i << " differs: " << out[i] << " vs " << expected[i] << '\n';
+            return false;
+        }
+    }
+    if (a->step != b->step || a->states != b->states) {
+        std::cout << name << ": network state differs after the sequence\n";
+        return false;
+    }
+    return true;
+}
+
+template <typename N>
+void benchmark(const size_t t) {
+    const auto in = make_inputs<N>(t);
+    std::vector<state_t> out(t * N::outputs_size);
+    auto net = std::make_unique<N>();
+    using clock = std::chrono::steady_clock;
+
+    const auto s0 = clock::now();
+    for (size_t k = 0; k < t; ++k) {
+        std::copy(&in[k * N::inputs_size], &in[(k + 1) * N::inputs_size], net->inputs);
+        net->activate();
+    }
+    const auto s1 = clock::now();
+    net->activate_sequence(in.data(), out.data(), t);
+    const auto s2 = clock::now();
+
+    std::cout << t << " steps: " << std::chrono::duration<double, std::nano>(s1 - s0).count() / t << " ns/step single, "
+              << std::chrono::duration<double, std::nano>(s2 - s1).count() / t << " ns/step as a sequence\n";
+}
+
+int main() {
+    using small_t = network<config<SUM_OF_SQUARE>, input<3>, gru<16, TANH>, output<2>>;
+    using wide_t = network<config<SUM_OF_SQUARE>, input<64>, gru<300, TANH>, mgu<40, TANH>, output<4>>;
+    using padded_t = network<config<SUM_OF_SQUARE, inline_storage<64>, 64>,
+                             steer_to_ideal<composite<input<2>, ratio<input<2>>>, composite<input<2>, ratio<input<2>>>>,
+                             gru<37, TANH>,
+                             composite<output<2>, ratio<output<2>>>>;
+
+    static_assert(!input<3>::recurrent && !ratio<output<2>>::recurrent);
+    static_assert(gru<4>::recurrent && composite<input<2>, mgu<2>>::recurrent);
+
+    if (!check<small_t>("small", 1) || !check<small_t>("small", 200) ||
+        !check<wide_t>("wide", 150) || !check<padded_t>("padded", 333)) {
+        return 1;
+    }
+
+    benchmark<wide_t>(4096);
+    return 0;
+}
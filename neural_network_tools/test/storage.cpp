@@ -0,0 +1,99 @@
+#include "../all.hpp"
+
+#include <iostream>
+#include <vector>
+
+
+int main() {
+    using namespace neural_network_tools;
+
+    using inline_net_t = network<config<SUM_OF_SQUARE>, input<3>, gru<64, TANH>, output<2>>;
+    using owned_net_t  = network<config<SUM_OF_SQUARE, owned_storage<>>, input<3>, gru<64, TANH>, output<2>>;
+    using arena_net_t  = network<config<SUM_OF_SQUARE, arena_storage<>>, input<3>, gru<64, TANH>, output<2>>;
+
+    constexpr size_t count = 1000;
+
+    inline_net_t reference;
+    owned_net_t owned;
+    slab s { arena_net_t::storage_bytes * count, true };
+
+    std::vector<arena_net_t> nets;
+    nets.reserve(count);
+    for (size_t i = 0; i < count; ++i) nets.emplace_back(s);
+
+    std::cout << "Slab use: " << s.size() << " bytes for " << count << " networks of "
+              << arena_net_t::storage_bytes << " bytes\n";
+
+    for (const auto& n : nets) {
+        if (reinterpret_cast<uintptr_t>(n.weights.data()) % cache_line_size ||
+            reinterpret_cast<uintptr_t>(n.states.data()) % cache_line_size) {
+            std::cout << "Misaligned buffer\n";
+            return 1;
+        }
+    }
+
+    for (int step = 0; step < 10; ++step) {
+        for (size_t i = 0; i < inline_net_t::inputs_size; ++i) {
+            reference.inputs[i] = 0.1 * (i + step);
+            owned.inputs[i] = 0.1 * (i + step);
+            for (auto& n : nets) n.inputs[i] = 0.1 * (i + step);
+        }
+        reference.activate();
+        owned.activate();
+        for (auto& n : nets) n.activate();
+    }
+
+    const owned_net_t copy { owned };
+
+    for (size_t o = 0; o < inline_net_t::outputs_size; ++o) {
+        std::cout << "Output " << o << ": " << reference.outputs[o] << '\n';
+        if (owned.outputs[o] != reference.outputs[o] ||
+            copy.outputs[o] != reference.outputs[o] ||
+            copy.outputs == owned.outputs) {
+            std::cout << "Owned storage diverged\n";
+            return 1;
+        }
+        for (const auto& n : nets) {
+            if (n.outputs[o] != reference.outputs[o]) {
+                std::cout << "Arena storage diverged\n";
+                return 1;
+            }
+        }
+    }
+
+    // Snapshots follow the storage policy, and survive a round trip
+    static_assert(sizeof(owned_net_t::snapshot) < 64 && sizeof(arena_net_t::snapshot) < 64, "Snapshots of owned and arena networks must keep their buffers out of line");
+    const auto snap = nets[0].fork();
+    const auto owned_snap = owned.fork();
+    nets[0].activate();
+    owned.activate();
+    nets[0].restore(snap);
+    owned.restore(owned_snap);
+    for (size_t o = 0; o < inline_net_t::outputs_size; ++o) {
+        if (nets[0].outputs[o] != reference.outputs[o] || owned.outputs[o] != reference.outputs[o]) {
+            std::cout << "Snapshot restore diverged\n";
+            return 1;
+        }
+    }
+
+    // Assignment to a moved from buffer
+    auto moved = owned.fork();
+    auto taken = std::move(moved);
+    moved = owned_snap;
+    taken = std::move(moved);
+    moved = taken;
+    if (!std::equal(moved.states.begin(), moved.states.end(), owned_snap.states.begin()) ||
+        !std::equal(taken.states.begin(), taken.states.end(), owned_snap.states.begin())) {
+        std::cout << "Assignment after a move lost the state\n";
+        return 1;
+    }
+
+    // Only buffers of a huge page or more get a huge page mapping of their own
+    using huge_net_t = network<config<SUM_OF_SQUARE, owned_storage<cache_line_size, true>>,
+                               input<3>, simple<1024, TANH>, simple<512, TANH>, output<2>>;
+    static_assert(!huge_net_t::array_t<state_t, huge_net_t::states_size>::huge &&
+                  huge_net_t::array_t<weight_t, huge_net_t::weights_size>::huge,
+                  "Huge pages only above the threshold");
+    huge_net_t huge;
+    huge.activate();
+}
@@ -0,0 +1,100 @@
+#include "../all.hpp"
+#include "../telemetry.hpp"
+
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+
+using namespace neural_network_tools;
+
+/// Field by field, records have padding bytes.
+template <typename R>
+bool same(const R& a, const R& b) {
+    return a.step == b.step && a.checked == b.checked && a.error == b.error && a.weight_norm == b.weight_norm &&
+           a.saturation == b.saturation && a.outputs == b.outputs;
+}
+
+/// Saturation counts the real hidden states only, not the layout padding.
+bool padded_saturation() {
+    using padded_t = network<config<SUM_OF_SQUARE, inline_storage<>, 32>, input<3>, gru<5, TANH>, output<2>>;
+    static_assert(padded_t::layout[1].size < padded_t::pad(padded_t::layout[1].size), "Hidden layer must have padding");
+    padded_t net;
+    padded_t::for_each_state_run([&](const size_t o, const size_t n) {
+        for (size_t i = o; i < o + n; ++i) net.states[i] = 1;
+    });
+    telemetry<padded_t, 2> tel { 1, 1 };
+    tel.record(net);
+    telemetry_record<padded_t> r;
+    return tel.pop(r) && r.saturation == 1;
+}
+
+int main() {
+    using net_t = network<config<SUM_OF_SQUARE>, input<3>, gru<16, TANH>, output<2>>;
+
+    static_assert(std::is_empty_v<no_telemetry>, "Disabled telemetry must not take space");
+
+    const std::string path { "telemetry_test.log" };
+    constexpr const size_t steps { 20'000 };
+    constexpr const size_t every { 10 };
+
+    net_t net;
+    telemetry<net_t, 256> tel { every, 8 };
+    std::vector<telemetry_record<net_t>> seen;
+    {
+        telemetry_log<net_t> log { path };
+        telemetry_drain<decltype(tel)> drain { tel, [&](const telemetry_record<net_t>& r) {
+            log(r);
+            seen.push_back(r);
+        } };
+        for (size_t i = 0; i < steps; ++i) {
+            net.inputs[0] = 0.5;
+            net.inputs[1] = static_cast<accumulator_t>(i % 7) / 7;
+            net.inputs[2] = -0.25;
+            net.activate();
+            if (i % 3 == 0) net.train(); // Records in between carry an older error
+            tel.record(net);
+        }
+    }
+
+    const auto records = telemetry_log<net_t>::read(path);
+    std::remove(path.c_str());
+
+    std::cout << records.size() << " records, " << tel.dropped() << " dropped\n";
+    if (records.size() + tel.dropped() != steps / every || records.size() != seen.size()) {
+        std::cout << "Records went missing\n";
+        return 1;
+    }
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (!same(records[i], seen[i])) {
+            std::cout << "Log differs from the records drained at " << i << '\n';
+            return 1;
+        }
+        if (records[i].checked > records[i].step || records[i].step - records[i].checked >= 3) {
+            std::cout << "Record " << i << " doesn't tell which step its error belongs to\n";
+            return 1;
+        }
+        if (i && records[i].step <= records[i - 1].step) {
+            std::cout << "Steps out of order at " << i << '\n';
+            return 1;
+        }
+    }
+    if (tel.dropped() == 0) {
+        const auto& last = records.back();
+        if (last.step != net.step || last.checked != net.last_checked || last.error != net.error ||
+            last.outputs[0] != net.outputs[0] || last.outputs[1] != net.outputs[1]) {
+            std::cout << "Last record does not match the network\n";
+            return 1;
+        }
+    }
+    if (!(records.front().weight_norm > 0) || records.front().saturation < 0 || records.front().saturation > 1) {
+        std::cout << "Weight norm or saturation out of range\n";
+        return 1;
+    }
+    if (!padded_saturation()) {
+        std::cout << "Layout padding counted in the saturation\n";
+        return 1;
+    }
+    return 0;
+}
@@ -48,6 +48,20 @@ namespace neural_network_tools {
     struct has_weights_size <T, decltype((void) T::weights_size, 0)> : std::true_type { };
 
 
+    /**
+     * @brief Running offsets of a list of consecutive blocks, starting at 0.
+     * 
+     * @tparam Ns Block sizes
+     */
+    template <size_t... Ns>
+    constexpr std::array<size_t, sizeof...(Ns)> prefix_offsets() noexcept {
+        std::array<size_t, sizeof...(Ns)> ret {};
+        size_t n = 0;
+        size_t i = 0;
+        ((ret[i++] = n, n += Ns), ...);
+        return ret;
+    }
+
     template <typename T, typename...>
     static constexpr size_t input_count = T::size;
 
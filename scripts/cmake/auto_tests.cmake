@@ -3,6 +3,7 @@
 
 if (EXISTS "${CMAKE_SOURCE_DIR}/test")
     enable_testing()
+    find_package(Threads REQUIRED)
     # Find tests
     execute_process (
         COMMAND find -L "${CMAKE_SOURCE_DIR}/test/" -mindepth 1 -maxdepth 1 -type f -regex ".*\\.\\(c\\|cpp\\|cxx|c\\+\\+\\)$"
@@ -30,6 +31,8 @@ if (EXISTS "${CMAKE_SOURCE_DIR}/test")
                 CXX_STANDARD_REQUIRED ON
             )
 
+            target_link_libraries(test_${TEST_NAME} PRIVATE Threads::Threads rt)
+
             # Set any test compilation options here
             if ("_${CMAKE_BUILD_TYPE}" STREQUAL "_Release")
                 target_compile_options(test_${TEST_NAME} PRIVATE "-std=gnu++17;-O3;-Wfatal-errors")
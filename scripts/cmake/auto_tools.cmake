@@ -0,0 +1,41 @@
+# Locate single C++ file tools in `./tools/` (daemons, load generators and
+# the like). They are built with the project, but not run by `make check`.
+
+if (EXISTS "${CMAKE_SOURCE_DIR}/tools")
+    find_package(Threads REQUIRED)
+
+    execute_process (
+        COMMAND find -L "${CMAKE_SOURCE_DIR}/tools/" -mindepth 1 -maxdepth 1 -type f -regex ".*\\.\\(c\\|cpp\\|cxx|c\\+\\+\\)$"
+        COMMAND sed -r "s|${CMAKE_SOURCE_DIR}/tools/||"
+        COMMAND sort
+        COMMAND uniq
+        COMMAND tr '\n' '\;'
+        OUTPUT_VARIABLE TOOL_SOURCES
+        OUTPUT_STRIP_TRAILING_WHITESPACE
+    )
+
+    set (TOOL_NAMES)
+    foreach (TOOL_SOURCE IN LISTS TOOL_SOURCES)
+        if (NOT "_" STREQUAL "_${TOOL_SOURCE}" AND EXISTS "${CMAKE_SOURCE_DIR}/tools/${TOOL_SOURCE}")
+            string(REGEX REPLACE "\\.[^.]+$" "" TOOL_NAME "${TOOL_SOURCE}")
+            list (APPEND TOOL_NAMES ${TOOL_NAME})
+            add_executable(${TOOL_NAME} "${CMAKE_SOURCE_DIR}/tools/${TOOL_SOURCE}")
+
+            set_target_properties(
+                ${TOOL_NAME} PROPERTIES
+                CXX_STANDARD 17
+                CXX_STANDARD_REQUIRED ON
+            )
+            target_link_libraries(${TOOL_NAME} PRIVATE Threads::Threads rt)
+
+            if ("_${CMAKE_BUILD_TYPE}" STREQUAL "_Release")
+                target_compile_options(${TOOL_NAME} PRIVATE "-std=gnu++17;-O3;-Wfatal-errors")
+            else ()
+                target_compile_options(${TOOL_NAME} PRIVATE "-std=gnu++17;-O3;-ggdb;-Wall;-Wextra;-Wfatal-errors")
+            endif ()
+        endif()
+    endforeach ()
+
+    string (REGEX REPLACE "((^|;)[ \t]*([^;]+)($|;))" "\n\t\\3" TOOL_NAMES "${TOOL_NAMES}")
+    message(STATUS "Available tools:${ColourBold}${TOOL_NAMES}${ColourReset}")
+endif()
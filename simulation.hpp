@@ -0,0 +1,170 @@
+/**
+ * @brief Enecuum difficulty prediction neural network - Block simulation
+ * 
+ * @file simulation.hpp
+ * 
+ * A closed loop block stream for evaluating difficulty controllers. The
+ * stream gives the network hash rate, the PoA rate and a bias in the PoW
+ * share of marks for each block. Block times are exponentially distributed
+ * around difficulty / rate, the PoW share drifts towards the PoW reward share
+ * plus the bias.
+ * 
+ * A controller is called with the `observation` of each block and returns
+ * the `decision` for the next one.
+ */
+
+#pragma once
+
+#include "enecuum.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace enecuum {
+    struct observation {
+        double pow_time;
+        double poa_time;
+        double pow_share;
+    };
+
+    struct decision {
+        double pow_difficulty;
+        double poa_difficulty;
+        double pow_reward;
+    };
+
+    struct conditions {
+        double pow_rate;
+        double poa_rate;
+        double share_bias;
+    };
+
+    static constexpr const double initial_difficulty { target_time }; // Rates start at 1
+
+    /**
+     * @brief Exogenous conditions, simulated or replayed from a recording.
+     */
+    class block_stream {
+    private:
+        std::mt19937_64 e;
+        std::normal_distribution<> normal;
+        const std::vector<conditions> *recorded;
+        size_t block { 0 };
+        double log_pow { 0 };
+        double log_poa { 0 };
+        double bias { 0 };
+
+    public:
+        block_stream(const uint64_t seed, const std::vector<conditions> *recorded) noexcept :
+            e { seed }, recorded { recorded && !recorded->empty() ? recorded : nullptr } {}
+
+        conditions next() noexcept {
+            if (recorded) return (*recorded)[block++ % recorded->size()];
+            // Slow random walks, plus hash rate doubling or halving every 20000 blocks
+            if (++block % 20'000 == 0) log_pow += (block / 20'000) % 2 ? std::log(2) : -std::log(2);
+            log_pow += 0.002 * normal(e);
+            log_poa += 0.001 * normal(e);
+            bias += -0.001 * bias + 0.003 * normal(e);
+            return { std::exp(log_pow), std::exp(log_poa), bias };
+        }
+    };
+
+    struct quality {
+        static constexpr const size_t window { 144 };
+
+        size_t blocks { 0 };
+        double pow_time { 0 };
+        double poa_time { 0 };
+        double share_error { 0 };
+        double window_pow { 0 };
+        double window_poa { 0 };
+        double window_error { 0 };
+        size_t windows { 0 };
+
+        void add(const observation& o) noexcept {
+            ++blocks;
+            pow_time += o.pow_time;
+            poa_time += o.poa_time;
+            share_error += std::abs(o.pow_share - target_pow_share);
+            window_pow += o.pow_time;
+            window_poa += o.poa_time;
+            if (blocks % window == 0) {
+                const auto p = window_pow / (window * target_time) - 1;
+                const auto a = window_poa / (window * target_time) - 1;
+                window_error += (p * p + a * a) / 2;
+                ++windows;
+                window_pow = window_poa = 0;
+            }
+        }
+
+        double mean_pow_time() const noexcept { return pow_time / blocks; }
+        double mean_poa_time() const noexcept { return poa_time / blocks; }
+        /// RMS relative deviation of the mean block time per window from the target
+        double window_rms() const noexcept { return windows ? std::sqrt(window_error / windows) : 0; }
+        double mean_share_error() const noexcept { return share_error / blocks; }
+    };
+
+    /**
+     * @brief Run `blocks` blocks in closed loop, return the observations.
+     */
+    template <typename C>
+    std::vector<observation> simulate(C& controller, const size_t blocks, const uint64_t seed,
+                                      const std::vector<conditions> *recorded) {
+        block_stream stream { seed, recorded };
+        std::mt19937_64 e { seed ^ 0x9e3779b97f4a7c15ull };
+        std::exponential_distribution<> exponential;
+        std::normal_distribution<> normal;
+
+        std::vector<observation> observations;
+        observations.reserve(blocks);
+        decision d { initial_difficulty, initial_difficulty, target_pow_share };
+        double share = target_pow_share;
+        for (size_t i = 0; i < blocks; ++i) {
+            const auto c = stream.next();
+            const auto equilibrium = std::clamp(d.pow_reward + c.share_bias, 0.01, 0.99);
+            share += 0.05 * (equilibrium - share);
+            const observation o {
+                d.pow_difficulty / c.pow_rate * exponential(e),
+                d.poa_difficulty / c.poa_rate * exponential(e),
+                std::clamp(share + 0.02 * normal(e), 0.0, 1.0)
+            };
+            observations.push_back(o);
+            d = controller(o);
+        }
+        return observations;
+    }
+
+    /**
+     * @brief The network as a controller. Outputs 0 and 1 steer the PoW and
+     * PoA difficulty by at most 5% per block, output 2 is the PoW reward share.
+     */
+    template <typename N = network_t<>>
+    struct network_controller {
+        std::unique_ptr<N> net { std::make_unique<N>() };
+        double pow_difficulty { initial_difficulty };
+        double poa_difficulty { initial_difficulty };
+
+        network_controller() { set_targets(net->inputs); }
+
+        /// Controller running the weights of `trained`, from a fresh state.
+        explicit network_controller(const N& trained) : network_controller() {
+            std::copy(trained.weights.begin(), trained.weights.end(), net->weights.begin());
+        }
+
+        decision operator()(const observation& o) noexcept {
+            net->inputs[4] = o.pow_time;
+            net->inputs[5] = o.poa_time;
+            net->inputs[6] = o.pow_share;
+            net->inputs[7] = 1 - o.pow_share;
+            net->check(); // Against the previous prediction
+            net->train();
+            net->activate();
+            pow_difficulty *= std::exp(0.05 * std::tanh(net->outputs[0]));
+            poa_difficulty *= std::exp(0.05 * std::tanh(net->outputs[1]));
+            return { pow_difficulty, poa_difficulty, std::clamp<double>(net->outputs[2], 0.01, 0.99) };
+        }
+    };
+}
@@ -0,0 +1,186 @@
+/**
+ * @brief Enecuum difficulty prediction neural network - Controller benchmark
+ *
+ * @file controller_benchmark.cpp
+ *
+ * Drives one block stream through the network controller and the classic
+ * retargeting baselines in baselines.hpp, and reports control quality and
+ * the cost per decision.
+ *
+ * See simulation.hpp for the block stream. Every controller sees the same
+ * stream and the same random draws.
+ *
+ * The network needs trained weights to steer: without a checkpoint only its
+ * cost per decision is reported. With one it is held to the same regression
+ * guard as the baselines.
+ *
+ * Usage: test_controller_benchmark [-n BLOCKS] [-s SEED] [-r FILE] [-c CHECKPOINT]
+ *   -n  Blocks per controller (default 200000)
+ *   -s  Seed for the simulated stream and block time draws (default 1)
+ *   -r  Recorded stream instead of the simulated one, one block per line:
+ *       "pow_rate poa_rate share_bias", repeated if shorter than BLOCKS
+ *   -c  Network weights, a checkpoint written by es_train or predictiond
+ */
+
+#include "../baselines.hpp"
+#include "../simulation.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+
+namespace {
+    using namespace enecuum;
+
+    template <typename R>
+    struct retarget_controller {
+        R pow { initial_difficulty };
+        R poa { initial_difficulty };
+
+        decision operator()(const observation& o) noexcept {
+            // Classic retargets have no notion of the reward split
+            return { pow(o.pow_time), poa(o.poa_time), target_pow_share };
+        }
+    };
+
+    struct pid_controller {
+        pid_retarget pow { initial_difficulty };
+        pid_retarget poa { initial_difficulty };
+        pid share { 0.05, 0.01, 0 };
+        double reward { target_pow_share };
+
+        decision operator()(const observation& o) noexcept {
+            reward = std::clamp(reward + share(target_pow_share - o.pow_share), 0.01, 0.99);
+            return { pow(o.pow_time), poa(o.poa_time), reward };
+        }
+    };
+
+    /**
+     * @brief Cost per decision, replaying recorded observations open loop so
+     * the block simulation is not part of the timing.
+     *
+     * @param make  Returns a fresh controller
+     */
+    template <typename F>
+    double ns_per_decision(F&& make, const std::vector<observation>& observations) {
+        auto controller = make();
+        double sink = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto& o : observations) {
+            const auto d = controller(o);
+            sink += d.pow_difficulty + d.pow_reward;
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        volatile double keep = sink;
+        (void) keep;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / observations.size();
+    }
+
+    /**
+     * @brief Run and report the controllers `make` returns.
+     *
+     * @param quality_known False to report the cost only
+     */
+    template <typename F>
+    quality run(const char *name, F&& make, const size_t blocks, const uint64_t seed, const std::vector<conditions> *recorded,
+                const bool quality_known = true) {
+        quality q;
+        std::vector<observation> observations;
+        {
+            auto controller = make();
+            observations = simulate(controller, blocks, seed, recorded);
+        }
+        for (const auto& o : observations) q.add(o);
+        const auto ns = ns_per_decision(make, observations);
+
+        std::cout << std::left << std::setw(10) << name << std::right << std::fixed;
+        if (quality_known) {
+            std::cout << std::setw(10) << std::setprecision(2) << q.mean_pow_time()
+                      << std::setw(10) << q.mean_poa_time()
+                      << std::setw(11) << std::setprecision(2) << 100 * q.window_rms() << '%'
+                      << std::setw(10) << std::setprecision(4) << q.mean_share_error();
+        } else {
+            std::cout << std::left << std::setw(41) << "  untrained, see -c" << std::right;
+        }
+        std::cout << std::setw(12) << std::setprecision(1) << ns << '\n';
+        return q;
+    }
+
+    template <typename C>
+    C make() { return {}; }
+}
+
+int main(int argc, char **argv) {
+    size_t blocks = 200'000;
+    uint64_t seed = 1;
+    std::vector<conditions> recorded;
+    std::unique_ptr<network_t<>> trained;
+
+    for (int opt; (opt = getopt(argc, argv, "n:s:r:c:")) != -1;) {
+        switch (opt) {
+            case 'n': blocks = std::stoul(optarg); break;
+            case 's': seed = std::stoull(optarg); break;
+            case 'r': {
+                std::ifstream f { optarg };
+                for (conditions c; f >> c.pow_rate >> c.poa_rate >> c.share_bias;) recorded.push_back(c);
+                if (recorded.empty()) {
+                    std::cerr << "No blocks in " << optarg << '\n';
+                    return 2;
+                }
+                break;
+            }
+            case 'c': {
+                std::vector<char> buf(network_t<>::save_bytes);
+                if (!std::ifstream { optarg, std::ios::binary }.read(buf.data(), buf.size())) {
+                    std::cerr << "Can't read checkpoint " << optarg << '\n';
+                    return 2;
+                }
+                trained = std::make_unique<network_t<>>();
+                trained->restore(buf.data());
+                break;
+            }
+            default:
+                std::cerr << "Usage: " << argv[0] << " [-n BLOCKS] [-s SEED] [-r FILE] [-c CHECKPOINT]\n";
+                return 2;
+        }
+    }
+    if (!blocks) blocks = 1;
+
+    std::cout << blocks << " blocks, " << (recorded.empty() ? "simulated" : "recorded") << " stream, target "
+              << target_time << " s, PoW share " << target_pow_share << "\n\n"
+              << "controller  PoW s     PoA s     window rms  share err  ns/decision\n";
+
+    const auto *const r = recorded.empty() ? nullptr : &recorded;
+    const auto windowed = run("windowed", make<retarget_controller<windowed_retarget>>, blocks, seed, r);
+    const auto asert = run("asert", make<retarget_controller<asert_retarget>>, blocks, seed, r);
+    const auto pid = run("pid", make<pid_controller>, blocks, seed, r);
+    const auto network = trained
+        ? run("network", [&] { return network_controller<> { *trained }; }, blocks, seed, r)
+        : run("network", make<network_controller<>>, blocks, seed, r, false);
+
+    // Regression guard on the simulated stream: every controller with known
+    // quality must hold the target on average
+    if (recorded.empty() && blocks >= 100'000) {
+        const std::pair<const char *, const quality *> guarded[] {
+            { "windowed", &windowed }, { "asert", &asert }, { "pid", &pid }, { "network", trained ? &network : nullptr }
+        };
+        for (const auto& [name, q] : guarded) {
+            if (!q) continue;
+            for (const auto t : { q->mean_pow_time(), q->mean_poa_time() }) {
+                if (!(std::abs(t / target_time - 1) <= 0.1)) {
+                    std::cout << name << " lost the target block time\n";
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -10,60 +10,73 @@
  * dimensions are given for a cycle t+1 (calculateable). Error rates are
  * deviations from a calculated optimum, the network is trained to predict the
  * next 'controls' (difficulty and reward) from the series.
+ *
+ * Usage: test_enecuum [TELEMETRY_LOG]
+ *   Writes every 100th step to the given log, see telemetry.hpp.
  */
 
-#include "../neural_network_tools/all.hpp"
+#include "../enecuum.hpp"
+#include "../neural_network_tools/telemetry.hpp"
 
 #include <iostream>
-#include <random>
 
 
-int main() {
-    using namespace neural_network_tools;
+/// Realised inputs for step `i`, one Philox block per step so any step can be reproduced on its own.
+template <typename N>
+void set_realisations(N& net, const extra_math::philox4x32& rng, const uint64_t i) {
+    const auto rnd = rng.uniform_block(i);
+    net.inputs[4] = 2.5 * 60 + rnd[0]*10;
+    net.inputs[5] = 2.5 * 60 + rnd[1]*10;
+    net.inputs[6] = 0.2 + rnd[2]/10;
+    net.inputs[7] = 0.8 + rnd[3]/20;
+}
+
+template <typename N, typename S, typename T>
+void simulate(N& net, const extra_math::philox4x32& rng, S& schedule, T& telemetry) {
+    for (int i = 0; i < 1000'000; ++i) {
+        net.activate(); // Predict
+        
+        // **** Block finding phase ****
+        
+        // Update inputs
+        set_realisations(net, rng, i + 1);
 
-    std::default_random_engine e { 1u }; // Will result in the same 'random' generation each compile
-    std::uniform_real_distribution<> rnd(-1.0f, 1.0f); // Easy to scale
+        schedule.run(net); // Check prediction and retrain when the error history asks for it
+        telemetry.record(net);
+    }
+}
 
-    network<config<SUM_OF_SQUARE>,
-            steer_to_ideal<composite<input<2>, // Target PoW and PoA time
-                                     ratio<input<2>>>, // Target PoW and PoA ratio
-                           composite<input<2>, // Realised PoW and PoA time
-                                     ratio<input<2>>>>, // Realised PoW and PoA ratio
-            gru<(2+2+2+2)*(2+2)*5, TANH>, // 5 times inputs * outputs. General rule of thumb is 2-8 times i*o.
-            composite<output<2>, // PoW and PoA difficulty
-                      ratio<output<2>>> // PoW and PoA reward %
-            > net;
+int main(int argc, char **argv) {
+    using namespace enecuum;
+
+    const extra_math::philox4x32 rng { 1u }; // Same stream every run, step i uses block i
+
+    network_t<> net;
 
     // Pre-programmed targets for algorithm 1.0
-    net.inputs[0] = 2.5 * 60; // 2.5 minutes in s target time
-    net.inputs[1] = 2.5 * 60; // 2.5 minutes in s target time
-    net.inputs[2] = 0.2; // 20% of marks to PoW
-    net.inputs[3] = 0.8; // 80% of marks to PoA
+    set_targets(net.inputs);
     // For now fill the realisation inputs with random data. The last two should
-    // internally always add up to 100%, hence the radio filter above
-    net.inputs[4] = 2.5 * 60 + rnd(e)*10;
-    net.inputs[5] = 2.5 * 60 + rnd(e)*10;
-    net.inputs[6] = 0.2 + rnd(e)/10;
-    net.inputs[7] = 0.8 + rnd(e)/20;
+    // internally always add up to 100%, hence the ratio filter in the network
+    set_realisations(net, rng, 0);
 
     for (size_t i = 0; i < net.inputs_size; ++i) {
         std::cout << "Input: " << net.inputs[i] << '\n';
     }
 
-    for (int i = 0; i < 1000'000; ++i) {
-        net.activate(); // Predict
-        
-        // **** Block finding phase ****
-        
-        // Update inputs
-        net.inputs[4] = 2.5 * 60 + rnd(e)*10;
-        net.inputs[5] = 2.5 * 60 + rnd(e)*10;
-        net.inputs[6] = 0.2 + rnd(e)/10;
-        net.inputs[7] = 0.8 + rnd(e)/20;
-
-        net.check(); // Check prediction
-        net.train(); // Retrain the network with current error
+    check_schedule<network_t<>> schedule;
+    if (argc > 1) {
+        telemetry<network_t<>> tel { 100 };
+        {
+            telemetry_drain<decltype(tel)> drain { tel, telemetry_log<network_t<>> { argv[1] } };
+            simulate(net, rng, schedule, tel);
+        }
+        std::cout << "Telemetry records dropped: " << tel.dropped() << '\n';
+    } else {
+        no_telemetry tel;
+        simulate(net, rng, schedule, tel);
     }
+    std::cout << "Checked " << schedule.checks << " of " << schedule.steps << " steps, learned " << schedule.learns << " times\n";
+    net.check(); // Report the error of the final prediction
 
     for (size_t i = 0; i < net.errors_size; ++i) {
         std::cout << "Error " << i << ": " << net.errors[i] << '\n';
@@ -0,0 +1,209 @@
+/**
+ * @brief Enecuum difficulty prediction neural network - Recurrent cell comparison
+ *
+ * @file gru_variants.cpp
+ *
+ * Puts each recurrent cluster in the hidden layer of the controller network,
+ * trains it, and reports next to `gru`: the hidden layer weights, the time of
+ * one `activate()` and the control quality on a held out stream.
+ *
+ * Every cell is trained the same way: evolution strategies over the closed
+ * loop of simulation.hpp, with the fitness of es_train (minus the window RMS
+ * block time deviation plus the mean PoW share error), the same episodes and
+ * noise seeds, from zero weights. The default initial weights saturate every
+ * hidden state on raw block times, zero weights start from a controller that
+ * leaves the difficulty alone. The budget is fixed, so cells are compared at
+ * equal training effort; raise it for production numbers.
+ *
+ * `activate()` is timed on its own. Its cost doesn't depend on the weights,
+ * so the timing runs the default ones: the tiny states of freshly trained
+ * weights would time denormal arithmetic instead of the cell. The median of
+ * several repetitions is reported.
+ *
+ * Usage: test_gru_variants [-n BLOCKS] [-g GENERATIONS] [-p POPULATION] [-b BLOCKS] [-r REPETITIONS]
+ *   -n  Held out blocks per cell, also the activations per timing repetition (default 20000)
+ *   -g  Training generations per cell (default 60)
+ *   -p  Population per generation (default 16)
+ *   -b  Blocks per training episode (default 1000)
+ *   -r  Timing repetitions (default 7)
+ */
+
+#include "../simulation.hpp"
+#include "../neural_network_tools/evolution.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <unistd.h>
+
+
+namespace {
+    using namespace enecuum;
+
+    struct settings {
+        size_t blocks { 20'000 };
+        size_t generations { 60 };
+        size_t population { 16 };
+        size_t episode { 1000 };
+        size_t repetitions { 7 };
+    };
+
+    constexpr const uint64_t seed { 1 };
+    constexpr const uint64_t held_out { ~seed }; // As es_train
+
+    template <typename N>
+    quality episode(network_controller<N>& controller, const size_t blocks, const uint64_t s) {
+        quality q;
+        for (const auto& o : simulate(controller, blocks, s, nullptr)) q.add(o);
+        return q;
+    }
+
+    /// Train a controller with recurrent cluster `R`, return its quality on the held out stream.
+    template <template <size_t, activation_e> typename R>
+    quality train(const settings& set) {
+        using net_t = network_t<config<SUM_OF_SQUARE>, R>;
+
+        auto net = std::make_unique<net_t>();
+        net->weights.fill(0);
+        es_settings es;
+        es.population = set.population;
+        es.sigma = 0.003;           // Raw block times make the network sensitive to its input weights
+        es.learning_rate = 0.0003;
+        es.seed = seed;
+        es_trainer<net_t> trainer { *net, es };
+        for (size_t g = 0; g < set.generations; ++g) {
+            trainer.step([&](net_t& n, const uint64_t generation) {
+                network_controller<net_t> controller { n };
+                const auto q = episode(controller, set.episode, seed + generation);
+                return -(q.window_rms() + q.mean_share_error());
+            });
+        }
+
+        network_controller<net_t> controller { *net };
+        return episode(controller, set.blocks, held_out);
+    }
+
+    /// ns per `activate()` over `blocks` steps, on the default weights realising the targets.
+    template <template <size_t, activation_e> typename R>
+    double time_activate(const size_t blocks) {
+        using net_t = network_t<config<SUM_OF_SQUARE>, R>;
+
+        auto net = std::make_unique<net_t>();
+        set_targets(net->inputs);
+        set_targets(net->inputs + 4);
+        state_t sink {};
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < blocks; ++i) {
+            net->activate();
+            sink += net->outputs[0];
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        volatile state_t keep { sink };
+        (void)keep;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / blocks;
+    }
+
+    struct cell {
+        const char *name;
+        size_t weights;
+        quality (*train)(const settings&);
+        double (*time)(size_t);
+    };
+
+    template <template <size_t, activation_e> typename R>
+    cell make_cell(const char *name) {
+        return { name, network_t<config<SUM_OF_SQUARE>, R>::internal_weights_size, &train<R>, &time_activate<R> };
+    }
+
+    /// Difficulty ran off to zero or infinity, the quality figures mean nothing then.
+    bool lost(const quality& q) noexcept {
+        return !(q.window_rms() < 10);
+    }
+
+    template <size_t S, activation_e TA>
+    using gru_gb = gru<S, TA, FAST_SIGMOID, FAST_SIGMOID, true>;
+
+    template <size_t S, activation_e TA>
+    using gru1_gb = gru1<S, TA, FAST_SIGMOID, FAST_SIGMOID, true>;
+
+    template <size_t S, activation_e TA>
+    using mgu_gb = mgu<S, TA, FAST_SIGMOID, true>;
+}
+
+int main(int argc, char **argv) {
+    settings set;
+    for (int opt; (opt = getopt(argc, argv, "n:g:p:b:r:")) != -1;) {
+        switch (opt) {
+            case 'n': set.blocks = std::max<size_t>(quality::window, std::stoul(optarg)); break;
+            case 'g': set.generations = std::stoul(optarg); break;
+            case 'p': set.population = std::max<size_t>(2, std::stoul(optarg)); break;
+            case 'b': set.episode = std::max<size_t>(quality::window, std::stoul(optarg)); break;
+            case 'r': set.repetitions = std::max<size_t>(1, std::stoul(optarg)); break;
+            default:
+                std::cerr << "Usage: " << argv[0] << " [-n BLOCKS] [-g GENERATIONS] [-p POPULATION] [-b BLOCKS] [-r REPETITIONS]\n";
+                return 2;
+        }
+    }
+
+    std::cout << "Each cell trained from zero weights for " << set.generations << " generations of " << set.population
+              << " over " << set.episode << " block episodes,\n"
+              << set.blocks << " held out blocks, ns/activate the median of " << set.repetitions << " interleaved runs\n\n"
+              << "cell    weights ns/activate   speedup     PoW s   window rms  share err   vs gru\n";
+
+    const cell cells[] {
+        make_cell<gru>("gru"),
+        make_cell<gru_gb>("gru+b"),
+        make_cell<gru1>("gru1"),
+        make_cell<gru1_gb>("gru1+b"),
+        make_cell<gru2>("gru2"),
+        make_cell<gru3>("gru3"),
+        make_cell<mgu>("mgu"),
+        make_cell<mgu_gb>("mgu+b")
+    };
+    constexpr const size_t cell_count { std::size(cells) };
+
+    std::array<quality, cell_count> qualities;
+    for (size_t c = 0; c < cell_count; ++c) qualities[c] = cells[c].train(set);
+
+    // Round robin, so drift in the machine's speed hits every cell alike
+    std::array<std::vector<double>, cell_count> times;
+    for (size_t k = 0; k < set.repetitions; ++k) {
+        for (size_t c = 0; c < cell_count; ++c) times[c].push_back(cells[c].time(set.blocks));
+    }
+    std::array<double, cell_count> ns;
+    for (size_t c = 0; c < cell_count; ++c) {
+        auto& t = times[c];
+        std::nth_element(t.begin(), t.begin() + t.size() / 2, t.end());
+        ns[c] = t[t.size() / 2];
+    }
+
+    for (size_t c = 0; c < cell_count; ++c) {
+        const auto& q = qualities[c];
+        std::cout << std::left << std::setw(8) << cells[c].name << std::right << std::fixed
+                  << std::setw(7) << cells[c].weights
+                  << std::setw(12) << std::setprecision(1) << ns[c]
+                  << std::setw(9) << std::setprecision(2) << ns[0] / ns[c] << 'x';
+        if (lost(q)) {
+            std::cout << "  lost the target block time\n";
+            continue;
+        }
+        std::cout << std::setw(10) << std::setprecision(2) << q.mean_pow_time()
+                  << std::setw(12) << std::setprecision(2) << 100 * q.window_rms() << '%'
+                  << std::setw(11) << std::setprecision(4) << q.mean_share_error();
+        if (!lost(qualities[0])) std::cout << std::setw(9) << std::setprecision(3) << q.window_rms() / qualities[0].window_rms();
+        std::cout << '\n';
+    }
+
+    for (const auto t : ns) {
+        if (!std::isfinite(t)) {
+            std::cout << "Cell timing failed\n";
+            return 1;
+        }
+    }
+    return 0;
+}
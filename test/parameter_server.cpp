@@ -0,0 +1,176 @@
+/**
+ * @brief Parameter server with worker processes over both transports
+ *
+ * @file parameter_server.cpp
+ *
+ * Forks workers that pull, push a known update and retry after rejections,
+ * plus one deliberately stale push each. Checks that exactly the accepted
+ * updates reached the weights and that no stale update got through. Then
+ * checks that a socket client that doesn't read its pulls is disconnected
+ * rather than waited for, and that the shared memory slot of a worker that
+ * died is reclaimed.
+ */
+
+#include "../enecuum.hpp"
+#include "../neural_network_tools/parameter_server.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+namespace {
+    using namespace enecuum;
+    using net_t = network_t<config<SUM_OF_SQUARE, owned_storage<>>>;
+
+    constexpr const size_t pushes { 500 };              // Per worker, not counting the stale one
+    constexpr const uint32_t max_staleness { 4 };
+    constexpr const weight_t step { 1.0 / 1024 };       // Exact in binary, so the sum can be checked exactly
+
+    /// Worker process body, returns the exit status.
+    int work(const serving_transport_e transport, const std::string& address) {
+        parameter_client<net_t> client { transport, address };
+        auto weights = std::make_unique<std::array<weight_t, net_t::weights_size>>();
+        std::vector<weight_t> gradient(net_t::weights_size, step);
+
+        uint64_t version = client.pull(weights->data());
+        for (size_t i = 0; i < pushes; ++i) {
+            const auto r = client.push(gradient.data(), version);
+            if (r.accepted ? r.staleness > max_staleness : r.staleness <= max_staleness) return 1;
+            const auto pulled = client.pull(weights->data());
+            if (pulled < r.version) return 1; // Versions never go back
+            version = pulled;
+        }
+
+        // Wait until enough updates passed, then push against the initial weights
+        while (client.pull(weights->data()) <= max_staleness) std::this_thread::yield();
+        return client.push(gradient.data(), 0).accepted ? 1 : 0;
+    }
+
+    /// Pull without reading until the server gives up on the client.
+    void flood(const std::string& socket_path) {
+        const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        const auto addr = neural_network_tools::detail::unix_address(socket_path);
+        if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) < 0) return;
+        parameter_request<net_t> request;
+        request.op = PULL;
+        for (size_t i = 0; i < 100'000; ++i) {
+            if (send(fd, &request, request.header_size, MSG_NOSIGNAL) < 0) break; // Closed by the server
+        }
+        close(fd);
+    }
+
+    /// A worker dies holding the only slot, the next one must get it back.
+    bool reclaim(const std::string& shm_name) {
+        net_t net;
+        parameter_server<net_t, 1> server { net, {}, shm_name, 1, max_staleness };
+        std::atomic<bool> stop { false };
+        std::thread server_thread { [&] { server.run(stop); } };
+
+        const pid_t pid = fork();
+        if (!pid) {
+            auto client = new parameter_client<net_t, 1> { SHARED_MEMORY, shm_name }; // Never released
+            auto weights = std::make_unique<std::array<weight_t, net_t::weights_size>>();
+            client->pull(weights->data());
+            _exit(0);
+        }
+        int status = 0;
+        bool ok = pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && !WEXITSTATUS(status);
+        if (ok) {
+            try {
+                parameter_client<net_t, 1> client { SHARED_MEMORY, shm_name };
+                std::vector<weight_t> gradient(net_t::weights_size, step);
+                ok = client.push(gradient.data(), server.version()).accepted && server.applied == 1;
+            } catch (const std::exception& e) {
+                std::cout << "Reclaim: " << e.what() << '\n';
+                ok = false;
+            }
+        }
+        stop = true;
+        server_thread.join();
+        return ok;
+    }
+}
+
+int main() {
+    const auto id = std::to_string(getpid());
+    const std::string socket_path { "/tmp/enecuum_parameter_test_" + id + ".sock" };
+    const std::string shm_name { "/enecuum_parameter_test_" + id };
+
+    net_t net;
+    const auto initial = net.weights;
+    auto server = std::make_unique<parameter_server<net_t>>(net, socket_path, shm_name, 1, max_staleness);
+
+    const serving_transport_e transports[] { SHARED_MEMORY, SHARED_MEMORY, UNIX_SOCKET, UNIX_SOCKET };
+    std::vector<pid_t> workers;
+    for (const auto transport : transports) {
+        const pid_t pid = fork();
+        if (pid < 0) {
+            std::cout << "fork failed\n";
+            return 1;
+        }
+        if (!pid) {
+            int status = 1;
+            try {
+                status = work(transport, transport == SHARED_MEMORY ? shm_name : socket_path);
+            } catch (const std::exception& e) {
+                std::cout << "Worker: " << e.what() << '\n';
+            }
+            _exit(status); // Leave the socket and segment to the parent
+        }
+        workers.push_back(pid);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::atomic<bool> stop { false };
+    std::thread server_thread { [&] { server->run(stop); } };
+
+    int failures = 0;
+    for (const auto pid : workers) {
+        int status = 0;
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) ++failures;
+    }
+    flood(socket_path);
+    stop = true;
+    server_thread.join();
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const size_t total = std::size(transports) * (pushes + 1);
+    std::cout << "Applied " << server->applied << ", rejected " << server->rejected << " of " << total << " updates in "
+              << elapsed << " s, mean staleness " << static_cast<double>(server->total_staleness) / server->applied << '\n';
+
+    if (failures) {
+        std::cout << failures << " workers failed\n";
+        return 1;
+    }
+    if (server->disconnected != 1) {
+        std::cout << "Client that didn't read its pulls wasn't disconnected\n";
+        return 1;
+    }
+    if (server->applied + server->rejected != total || server->rejected < std::size(transports) || server->version() != server->applied) {
+        std::cout << "Update accounting is off\n";
+        return 1;
+    }
+
+    // Every applied update subtracted the same exact step
+    for (size_t i = 0; i < net_t::weights_size; ++i) {
+        auto expected = initial[i];
+        for (size_t k = 0; k < server->applied; ++k) expected -= step;
+        if (net.weights[i] != expected) {
+            std::cout << "Weight " << i << " is " << net.weights[i] << ", expected " << expected << '\n';
+            return 1;
+        }
+    }
+
+    server.reset(); // Free the segment name
+    if (!reclaim(shm_name)) {
+        std::cout << "Slot of a dead worker wasn't reclaimed\n";
+        return 1;
+    }
+    return 0;
+}
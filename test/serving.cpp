@@ -0,0 +1,143 @@
+/**
+ * @brief Prediction serving round trip over both transports
+ * 
+ * @file serving.cpp
+ */
+
+#include "../enecuum.hpp"
+#include "../neural_network_tools/serving.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+int main() {
+    using namespace enecuum;
+    using net_t = network_t<config<SUM_OF_SQUARE, owned_storage<>>>;
+    using clock = std::chrono::steady_clock;
+
+    const auto id = std::to_string(getpid());
+    const std::string socket_path { "/tmp/enecuum_serving_test_" + id + ".sock" };
+    const std::string shm_name { "/enecuum_serving_test_" + id };
+
+    net_t served;
+    net_t reference;
+    auto server = std::make_unique<prediction_server<net_t>>(served, socket_path, shm_name);
+    std::atomic<bool> stop { false };
+    std::thread server_thread { [&] { server->run(stop); } };
+
+    std::array<accumulator_t, net_t::inputs_size> inputs {};
+    set_targets(inputs.data());
+    set_targets(reference.inputs);
+
+    int failures = 0;
+    for (const auto transport : { SHARED_MEMORY, UNIX_SOCKET }) {
+        prediction_client<net_t> client { transport, transport == SHARED_MEMORY ? shm_name : socket_path };
+        std::vector<double> latencies;
+
+        for (size_t i = 0; i < 20'000; ++i) {
+            inputs[4] = target_time + i % 20 - 10;
+            inputs[5] = target_time + i % 14 - 7;
+            inputs[6] = target_pow_share + (i % 10) * 0.01;
+            inputs[7] = target_poa_share - (i % 10) * 0.01;
+            const auto op = i % 4 ? PREDICT : ADVANCE;
+
+            const auto t0 = clock::now();
+            const auto r = client.query(op, inputs.data());
+            latencies.push_back(std::chrono::duration<double, std::micro>(clock::now() - t0).count());
+
+            // Mirror the request on a local network
+            auto snap = reference.fork();
+            std::copy(inputs.begin(), inputs.end(), snap.inputs());
+            reference.activate(snap);
+            if (op == ADVANCE) reference.restore(snap);
+
+            if (!std::equal(r.outputs.begin(), r.outputs.end(), snap.outputs()) || r.step != snap.step) ++failures;
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << (transport == SHARED_MEMORY ? "Shared memory" : "Unix socket  ")
+                  << " latency us: p50 " << latencies[latencies.size() / 2]
+                  << ", p99 " << latencies[latencies.size() * 99 / 100] << '\n';
+    }
+
+    // A client built for another network type must not attach
+    try {
+        // Same message sizes, so only the layout fingerprint tells them apart
+        using other_t = network<config<SUM_OF_SQUARE>, input<net_t::inputs_size>, gru<3, TANH>, output<net_t::outputs_size>>;
+        prediction_client<other_t> other { SHARED_MEMORY, shm_name };
+        std::cout << "Client for another network type attached\n";
+        ++failures;
+    } catch (const std::runtime_error& e) {
+        std::cout << "Rejected: " << e.what() << '\n';
+    }
+
+    // A client that reads late stalls its channel, but loses nothing
+    {
+        constexpr const size_t in_flight { serving_channels<net_t>::depth + 16 };
+        prediction_client<net_t> late { SHARED_MEMORY, shm_name };
+        for (size_t i = 0; i < in_flight; ++i) late.send(PREDICT, inputs.data());
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        try {
+            for (uint32_t i = 0; i < in_flight; ++i) {
+                if (late.receive().seq != i) throw std::runtime_error("Response out of order");
+            }
+        } catch (const std::runtime_error& e) {
+            std::cout << "Late reader: " << e.what() << '\n';
+            ++failures;
+        }
+
+        // One that never reads gets an error instead of hanging
+        prediction_client<net_t> stuck { SHARED_MEMORY, shm_name, std::chrono::milliseconds(50) };
+        try {
+            for (size_t i = 0; i < 4 * serving_channels<net_t>::depth; ++i) stuck.send(PREDICT, inputs.data());
+            std::cout << "Client that never reads wasn't stopped\n";
+            ++failures;
+        } catch (const std::runtime_error&) {
+        }
+    }
+
+    // A client that dies holding its channel, without reading its responses,
+    // must stall neither the server nor the next owner of the channel
+    const pid_t child = fork();
+    if (child == 0) {
+        auto *crashing = new prediction_client<net_t> { SHARED_MEMORY, shm_name };
+        for (size_t i = 0; i < serving_channels<net_t>::depth + 16; ++i) crashing->send(PREDICT, inputs.data());
+        _exit(0);
+    }
+    waitpid(child, nullptr, 0);
+    {
+        std::vector<std::unique_ptr<prediction_client<net_t>>> clients;
+        for (size_t c = 0; c < serving_channels<net_t>::channels; ++c) {
+            clients.push_back(std::make_unique<prediction_client<net_t>>(SHARED_MEMORY, shm_name));
+        }
+        for (auto& c : clients) {
+            const auto seq = c->send(PREDICT, inputs.data());
+            if (c->receive().seq != seq) {
+                std::cout << "Stale response on a reclaimed channel\n";
+                ++failures;
+            }
+        }
+    }
+
+    stop = true;
+    server_thread.join();
+    std::cout << "Served " << server->served << " requests in " << server->batches << " batches, dropped "
+              << server->dropped << " responses\n";
+
+    if (server->dropped) {
+        std::cout << "Shared memory responses were dropped\n";
+        ++failures;
+    }
+    if (failures) {
+        std::cout << failures << " failures\n";
+        return 1;
+    }
+}
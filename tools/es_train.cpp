@@ -0,0 +1,85 @@
+/**
+ * @brief Enecuum difficulty prediction - Evolution strategies training
+ *
+ * @file es_train.cpp
+ *
+ * Trains the controller network on the closed loop block simulation of
+ * simulation.hpp with the evolution strategies trainer, and writes a
+ * checkpoint for `predictiond -c`. Fitness is minus the window RMS block
+ * time deviation plus the mean PoW share error. Every member of a generation
+ * runs the same episode, each generation a new one. Progress is reported on
+ * a held out episode.
+ *
+ * Usage: es_train [-g GENERATIONS] [-p POPULATION] [-b BLOCKS] [-t THREADS] [-s SEED] [-o CHECKPOINT]
+ *   -g  Generations (default 100)
+ *   -p  Population per generation (default 32)
+ *   -b  Blocks per episode (default 5000)
+ *   -t  Threads (default every core)
+ *   -s  Seed for the noise and the episodes (default 1)
+ *   -o  Checkpoint to write (default controller.bin)
+ */
+
+#include "../simulation.hpp"
+#include "../neural_network_tools/evolution.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <unistd.h>
+
+
+int main(int argc, char **argv) {
+    using namespace enecuum;
+    using net_t = network_t<>;
+
+    size_t generations = 100;
+    size_t blocks = 5000;
+    std::string checkpoint { "controller.bin" };
+    es_settings settings;
+
+    for (int opt; (opt = getopt(argc, argv, "g:p:b:t:s:o:")) != -1;) {
+        switch (opt) {
+            case 'g': generations = std::stoul(optarg); break;
+            case 'p': settings.population = std::stoul(optarg); break;
+            case 'b': blocks = std::max<size_t>(quality::window, std::stoul(optarg)); break;
+            case 't': settings.threads = std::stoul(optarg); break;
+            case 's': settings.seed = std::stoull(optarg); break;
+            case 'o': checkpoint = optarg; break;
+            default:
+                std::cerr << "Usage: " << argv[0] << " [-g GENERATIONS] [-p POPULATION] [-b BLOCKS] [-t THREADS] [-s SEED] [-o CHECKPOINT]\n";
+                return 2;
+        }
+    }
+
+    const auto episode = [&](net_t& net, const uint64_t seed) {
+        network_controller<net_t> controller;
+        std::copy(net.weights.begin(), net.weights.end(), controller.net->weights.begin());
+        quality q;
+        for (const auto& o : simulate(controller, blocks, seed, nullptr)) q.add(o);
+        return -(q.window_rms() + q.mean_share_error());
+    };
+    const uint64_t held_out = ~settings.seed;
+
+    auto net = std::make_unique<net_t>();
+    es_trainer<net_t> trainer { *net, settings };
+    std::cout << "Held out fitness " << trainer.evaluate([&](net_t& n, uint64_t) { return episode(n, held_out); }) << '\n';
+
+    for (size_t g = 0; g < generations; ++g) {
+        const auto r = trainer.step([&](net_t& n, const uint64_t generation) { return episode(n, settings.seed + generation); });
+        if ((g + 1) % 10 == 0 || g + 1 == generations) {
+            std::cout << "Generation " << g + 1 << ": mean " << r.mean_fitness << ", best " << r.best_fitness
+                      << ", held out " << trainer.evaluate([&](net_t& n, uint64_t) { return episode(n, held_out); }) << '\n';
+        }
+    }
+
+    set_targets(net->inputs);
+    std::vector<char> buf(net_t::save_bytes);
+    net->save(buf.data());
+    if (!std::ofstream { checkpoint, std::ios::binary }.write(buf.data(), buf.size())) {
+        std::cerr << "Can't write " << checkpoint << '\n';
+        return 1;
+    }
+    std::cout << "Wrote " << checkpoint << '\n';
+}
@@ -0,0 +1,98 @@
+/**
+ * @brief Load generator for the prediction daemon
+ *
+ * @file predict_loadgen.cpp
+ *
+ * Runs a number of client threads against a running predictiond and reports
+ * round trip latency percentiles and throughput.
+ *
+ * Usage: predict_loadgen [-s SOCKET | -m SHM_NAME] [-n REQUESTS] [-t THREADS] [-p DEPTH] [-a]
+ *   -s  Connect over this Unix socket
+ *   -m  Connect over this shared memory segment (default /enecuum_predictor)
+ *   -n  Requests per thread (default 100000)
+ *   -t  Client threads (default 1)
+ *   -p  Requests in flight per thread, batched by the server (default 1, max 64)
+ *   -a  Send ADVANCE requests instead of PREDICT
+ */
+
+#include "../enecuum.hpp"
+#include "../neural_network_tools/serving.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+
+int main(int argc, char **argv) {
+    using namespace enecuum;
+    using net_t = network_t<config<SUM_OF_SQUARE, owned_storage<>>>;
+    using clock = std::chrono::steady_clock;
+
+    serving_transport_e transport = SHARED_MEMORY;
+    std::string address { "/enecuum_predictor" };
+    size_t requests = 100'000;
+    size_t threads = 1;
+    size_t depth = 1;
+    serving_op_e op = PREDICT;
+
+    for (int opt; (opt = getopt(argc, argv, "s:m:n:t:p:a")) != -1;) {
+        switch (opt) {
+            case 's': transport = UNIX_SOCKET; address = optarg; break;
+            case 'm': transport = SHARED_MEMORY; address = optarg; break;
+            case 'n': requests = std::stoul(optarg); break;
+            case 't': threads = std::stoul(optarg); break;
+            case 'p': depth = std::clamp<size_t>(std::stoul(optarg), 1, 64); break; // Up to the ring depth
+            case 'a': op = ADVANCE; break;
+            default:
+                std::cerr << "Usage: " << argv[0] << " [-s SOCKET | -m SHM_NAME] [-n REQUESTS] [-t THREADS] [-p DEPTH] [-a]\n";
+                return 2;
+        }
+    }
+
+    std::vector<std::vector<double>> latencies(threads);
+    std::vector<std::thread> workers;
+
+    const auto start = clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            prediction_client<net_t> client { transport, address };
+            std::array<accumulator_t, net_t::inputs_size> inputs {};
+            set_targets(inputs.data());
+            std::vector<clock::time_point> sent(depth);
+            auto& lat = latencies[t];
+            lat.reserve(requests);
+
+            for (size_t i = 0; i < requests; i += depth) {
+                const auto n = std::min(depth, requests - i);
+                for (size_t j = 0; j < n; ++j) {
+                    inputs[4] = target_time + (i + j) % 20 - 10;
+                    inputs[5] = target_time + (i + j) % 14 - 7;
+                    inputs[6] = target_pow_share;
+                    inputs[7] = target_poa_share;
+                    sent[j] = clock::now();
+                    client.send(op, inputs.data());
+                }
+                for (size_t j = 0; j < n; ++j) {
+                    client.receive();
+                    lat.push_back(std::chrono::duration<double, std::micro>(clock::now() - sent[j]).count());
+                }
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    const auto elapsed = std::chrono::duration<double>(clock::now() - start).count();
+
+    std::vector<double> all;
+    for (const auto& l : latencies) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    const auto pct = [&](const double p) { return all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))]; };
+
+    std::cout << "Requests:   " << all.size() << " over " << threads << " thread(s), depth " << depth << '\n'
+              << "Throughput: " << all.size() / elapsed << " req/s\n"
+              << "Latency us: p50 " << pct(0.5) << ", p90 " << pct(0.9) << ", p99 " << pct(0.99)
+              << ", p99.9 " << pct(0.999) << ", max " << all.back() << '\n';
+}
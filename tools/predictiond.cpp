@@ -0,0 +1,95 @@
+/**
+ * @brief Enecuum difficulty prediction daemon
+ *
+ * @file predictiond.cpp
+ *
+ * Keeps the controller network hot and answers "next difficulty/reward for
+ * these realised inputs" requests from node software on the same host, see
+ * neural_network_tools/serving.hpp for the protocol.
+ *
+ * Usage: predictiond [-s SOCKET] [-m SHM_NAME] [-c CHECKPOINT] [-w] [-k PLAN]
+ *   -s  Unix socket path (default /tmp/enecuum_predictor.sock, "" to disable)
+ *   -m  Shared memory name (default /enecuum_predictor, "" to disable)
+ *   -c  Checkpoint to load, as written by network::save()
+ *   -w  Write the network back to the checkpoint on exit
+ *   -k  Kernel plan cache, tuned and written on first use (see autotune.hpp)
+ */
+
+#include "../enecuum.hpp"
+#include "../neural_network_tools/serving.hpp"
+
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <unistd.h>
+
+
+namespace {
+    std::atomic<bool> stop { false };
+
+    void on_signal(int) { stop = true; }
+}
+
+int main(int argc, char **argv) {
+    using namespace enecuum;
+    using net_t = network_t<config<SUM_OF_SQUARE, owned_storage<>>>;
+
+    std::string socket_path { "/tmp/enecuum_predictor.sock" };
+    std::string shm_name { "/enecuum_predictor" };
+    std::string checkpoint;
+    std::string plan;
+    bool write_back = false;
+
+    for (int opt; (opt = getopt(argc, argv, "s:m:c:wk:")) != -1;) {
+        switch (opt) {
+            case 's': socket_path = optarg; break;
+            case 'm': shm_name = optarg; break;
+            case 'c': checkpoint = optarg; break;
+            case 'w': write_back = true; break;
+            case 'k': plan = optarg; break;
+            default:
+                std::cerr << "Usage: " << argv[0] << " [-s SOCKET] [-m SHM_NAME] [-c CHECKPOINT] [-w] [-k PLAN]\n";
+                return 2;
+        }
+    }
+
+    if (!plan.empty()) {
+        autotuner<net_t>::use(plan);
+    }
+
+    net_t net;
+    set_targets(net.inputs);
+
+    if (!checkpoint.empty()) {
+        std::vector<char> buf(net_t::save_bytes);
+        std::ifstream f { checkpoint, std::ios::binary };
+        if (f.read(buf.data(), buf.size())) {
+            net.restore(buf.data());
+            std::cout << "Loaded checkpoint " << checkpoint << " at step " << net.step << '\n';
+        } else if (!write_back) {
+            std::cerr << "Can't read checkpoint " << checkpoint << '\n';
+            return 1;
+        }
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    // The server holds a batch of snapshots, keep it off the stack
+    auto server = std::make_unique<prediction_server<net_t>>(net, socket_path, shm_name);
+    std::cout << "Serving on " << (socket_path.empty() ? "-" : socket_path)
+              << " and " << (shm_name.empty() ? "-" : shm_name) << '\n';
+
+    server->run(stop);
+
+    std::cout << "Served " << server->served << " requests in " << server->batches << " batches, dropped " << server->dropped << " responses\n";
+
+    if (write_back && !checkpoint.empty()) {
+        std::vector<char> buf(net_t::save_bytes);
+        net.save(buf.data());
+        std::ofstream { checkpoint, std::ios::binary }.write(buf.data(), buf.size());
+    }
+}